@@ -2,12 +2,342 @@
 #include <cmath>
 #include <chrono>
 #include <vector>
+#include <array>
 #include <iomanip>
 #include <immintrin.h> // SSE intrinsics
 #include <cstring>
+#include <cfloat>
+#include <cstdint>
+#include <algorithm>
+#include <string>
+#include <charconv>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <type_traits>
+#include <cerrno>
+#include <climits>
+#include <limits>
+#include <sstream>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <malloc.h>
+#include <alloca.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/futex.h>
+#include <csignal>
+#include <dlfcn.h>
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+#include <coroutine>
+#include <span>
+#include <stop_token>
+#define SQRT_COROUTINES 1
+#endif
+
+#include "sqrt_plugin.h"
+
+// ==================== INSTRUMENTATION ====================
+// Hot-path counters, compiled out entirely unless built with
+// -DSQRT_INSTRUMENT. Per kernel they count calls, elements, inputs that
+// reach a special case (negative, zero, one, subnormal, NaN), elements that
+// went through the padded tail of a batch, and which variant ran (AVX2 or
+// scalar, and the tier). Each thread counts into its own cache-line-aligned
+// block with plain loads and stores; sqrt_counters_report() sums the blocks.
+
+enum SqrtKernel {
+    KERNEL_NEWTON, KERNEL_BINARY, KERNEL_SSE_FAST, KERNEL_BITHACK, KERNEL_SSE_EXACT, KERNEL_OPTIMAL,
+    KERNEL_BATCH_F64, KERNEL_BATCH_F32, KERNEL_NORMAL_F64, KERNEL_NORMAL_F32, KERNEL_WIDEN, KERNEL_NARROW,
+    KERNEL_COUNT
+};
+
+static const char* const KERNEL_NAMES[KERNEL_COUNT] = {
+    "sqrt_newton", "sqrt_binary", "sqrt_sse_fast", "sqrt_bithack", "sqrt_sse_exact", "sqrt_optimal",
+    "sqrt_batch(f64)", "sqrt_batch(f32)", "sqrt_batch_normal(f64)", "sqrt_batch_normal(f32)",
+    "sqrt_batch(f32->f64)", "sqrt_batch(f64->f32)"
+};
+
+#if defined(SQRT_INSTRUMENT)
+enum SqrtCounter {
+    COUNT_CALLS, COUNT_ELEMENTS,
+    COUNT_NEGATIVE, COUNT_ZERO, COUNT_ONE, COUNT_SUBNORMAL, COUNT_NAN,
+    COUNT_TAIL, COUNT_AVX2, COUNT_SCALAR, COUNT_EXACT, COUNT_OPTIMAL, COUNT_FAST,
+    COUNT_KINDS
+};
+
+struct alignas(64) SqrtThreadCounters {
+    uint64_t v[KERNEL_COUNT][COUNT_KINDS];
+    SqrtThreadCounters* next;
+};
+
+// Blocks are never freed, so counts from finished threads still add up
+static std::atomic<SqrtThreadCounters*> sqrt_counter_blocks{nullptr};
+
+static SqrtThreadCounters* sqrt_thread_counters() {
+    thread_local SqrtThreadCounters* mine = nullptr;
+    if (!mine) {
+        mine = new SqrtThreadCounters();
+        mine->next = sqrt_counter_blocks.load(std::memory_order_relaxed);
+        while (!sqrt_counter_blocks.compare_exchange_weak(mine->next, mine, std::memory_order_release)) {}
+    }
+    return mine;
+}
+
+// Only the owning thread writes; relaxed atomics keep the report's reads defined
+static inline void sqrt_count(uint64_t* row, SqrtCounter c, uint64_t n) {
+    __atomic_store_n(&row[c], __atomic_load_n(&row[c], __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+template <class T>
+static inline void sqrt_count_input(uint64_t* row, T x) {
+    if (x < 0) sqrt_count(row, COUNT_NEGATIVE, 1);
+    else if (x == 0) sqrt_count(row, COUNT_ZERO, 1);
+    else if (x == 1) sqrt_count(row, COUNT_ONE, 1);
+    else if (x != x) sqrt_count(row, COUNT_NAN, 1);
+    else if (std::fpclassify(x) == FP_SUBNORMAL) sqrt_count(row, COUNT_SUBNORMAL, 1);
+}
+
+template <class T>
+static inline void sqrt_count_scalar(SqrtKernel k, T x) {
+    uint64_t* row = sqrt_thread_counters()->v[k];
+    sqrt_count(row, COUNT_CALLS, 1);
+    sqrt_count(row, COUNT_ELEMENTS, 1);
+    sqrt_count(row, COUNT_SCALAR, 1);
+    sqrt_count_input(row, x);
+}
+
+// width is the vector length of the variant that runs, 1 for scalar loops
+template <class T>
+static inline void sqrt_count_batch(SqrtKernel k, const T* in, size_t n, int tier, size_t width) {
+    uint64_t* row = sqrt_thread_counters()->v[k];
+    sqrt_count(row, COUNT_CALLS, 1);
+    sqrt_count(row, COUNT_ELEMENTS, n);
+    sqrt_count(row, width > 1 ? COUNT_AVX2 : COUNT_SCALAR, 1);
+    sqrt_count(row, (SqrtCounter)(COUNT_EXACT + tier), 1);
+    if (width > 1) sqrt_count(row, COUNT_TAIL, n % width);
+    for (size_t i = 0; i < n; i++) sqrt_count_input(row, in[i]);
+}
+
+void sqrt_counters_report(std::ostream& os) {
+    uint64_t total[KERNEL_COUNT][COUNT_KINDS] = {};
+    for (SqrtThreadCounters* b = sqrt_counter_blocks.load(std::memory_order_acquire); b; b = b->next) {
+        for (int k = 0; k < KERNEL_COUNT; k++) {
+            for (int c = 0; c < COUNT_KINDS; c++) total[k][c] += __atomic_load_n(&b->v[k][c], __ATOMIC_RELAXED);
+        }
+    }
+    static const char* const heads[] = {"calls", "elements", "neg", "zero", "one", "subnorm", "nan",
+                                        "tail", "avx2", "scalar", "exact", "optimal", "fast"};
+    os << "\nINSTRUMENTATION COUNTERS:\n" << std::left << std::setw(24) << "kernel" << std::right;
+    for (const char* h : heads) os << std::setw(h == heads[0] || h == heads[1] ? 12 : 9) << h;
+    os << "\n" << std::string(24 + 2 * 12 + 11 * 9, '-') << "\n";
+    for (int k = 0; k < KERNEL_COUNT; k++) {
+        if (total[k][COUNT_CALLS] == 0) continue;
+        os << std::left << std::setw(24) << KERNEL_NAMES[k] << std::right;
+        for (int c = 0; c < COUNT_KINDS; c++) os << std::setw(c < 2 ? 12 : 9) << total[k][c];
+        os << "\n";
+    }
+}
+
+#define SQRT_COUNT_SCALAR(kernel, x) sqrt_count_scalar(kernel, x)
+#define SQRT_COUNT_BATCH(kernel, in, n, tier, width) sqrt_count_batch(kernel, in, n, tier, width)
+#else
+#define SQRT_COUNT_SCALAR(kernel, x) ((void)0)
+#define SQRT_COUNT_BATCH(kernel, in, n, tier, width) ((void)0)
+#endif
+
+// ==================== USDT TRACEPOINTS ====================
+// Statically defined tracepoints (provider "hpcsqrt") at batch entry/exit
+// and at each dispatch decision, so bpftrace or perf can probe a running
+// process without a special build:
+//
+//   bpftrace -e 'usdt:./sqrt:hpcsqrt:batch_entry { @len[arg0] = hist(arg1); }'
+//
+//   batch_entry(kernel, n, tier)  batch_exit(kernel, n, tier)
+//   dispatch(kernel, tier, avx2)  sqb_block(block, clean, tier)
+//
+// kernel is a SqrtKernel id and tier a SqrtTier. Each probe site is a
+// single nop plus a .note.stapsdt entry describing where its arguments
+// live; a tracer patches the nop only while attached. Uses <sys/sdt.h> when
+// available, otherwise emits the same notes itself (x86-64 ELF).
+
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define SQRT_PROBE3(name, a1, a2, a3) STAP_PROBE3(hpcsqrt, name, a1, a2, a3)
+#elif defined(__x86_64__) && defined(__ELF__)
+// Argument descriptor: byte size (negative if signed) @ operand
+template <class T>
+constexpr int sqrt_sdt_size() { return std::is_signed<T>::value ? -(int)sizeof(T) : (int)sizeof(T); }
+#define SQRT_SDT_ARG(n) "%c[s" #n "]@%[a" #n "]"
+#define SQRT_PROBE3(name, x1, x2, x3)                                                   \
+    __asm__ __volatile__(                                                               \
+        "990: nop\n"                                                                    \
+        ".pushsection .note.stapsdt,\"?\",\"note\"\n"                                   \
+        ".balign 4\n"                                                                   \
+        ".4byte 992f-991f, 994f-993f, 3\n"                                              \
+        "991: .asciz \"stapsdt\"\n"                                                     \
+        "992: .balign 4\n"                                                              \
+        "993: .8byte 990b\n"                                                            \
+        ".8byte _.stapsdt.base\n"                                                       \
+        ".8byte 0\n"                                                                    \
+        ".asciz \"hpcsqrt\"\n"                                                          \
+        ".asciz \"" #name "\"\n"                                                        \
+        ".asciz \"" SQRT_SDT_ARG(1) " " SQRT_SDT_ARG(2) " " SQRT_SDT_ARG(3) "\"\n"      \
+        "994: .balign 4\n"                                                              \
+        ".popsection\n"                                                                 \
+        ".ifndef _.stapsdt.base\n"                                                      \
+        ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"         \
+        ".weak _.stapsdt.base\n"                                                        \
+        ".hidden _.stapsdt.base\n"                                                      \
+        "_.stapsdt.base: .space 1\n"                                                    \
+        ".size _.stapsdt.base, 1\n"                                                     \
+        ".popsection\n"                                                                 \
+        ".endif\n"                                                                      \
+        :: [s1] "n"(sqrt_sdt_size<decltype(x1)>()), [a1] "nor"(x1),                     \
+           [s2] "n"(sqrt_sdt_size<decltype(x2)>()), [a2] "nor"(x2),                     \
+           [s3] "n"(sqrt_sdt_size<decltype(x3)>()), [a3] "nor"(x3))
+#else
+#define SQRT_PROBE3(name, a1, a2, a3) ((void)0)
+#endif
+
+// ==================== TIMELINE TRACING ====================
+// Lightweight span tracing for when parallel runs don't scale: batch calls,
+// thread-pool tasks and I/O stages record begin/end TSC into a per-thread
+// buffer, and sqrt_trace_dump() writes Chrome trace-event JSON (open it in
+// chrome://tracing or ui.perfetto.dev). Set SQRT_TRACE=out.json to trace any
+// run of this binary.
+//
+// Each buffer has a single writer that publishes with a release store of its
+// count, so recording takes no locks; a full buffer drops further spans.
+// When tracing is off a TraceScope costs one relaxed load.
+
+static inline uint64_t trace_clock() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+struct TraceSpan {
+    const char* name;  // string literal
+    uint64_t begin, end;
+    uint64_t arg;
+};
+
+struct TraceBuffer {
+    static const size_t CAPACITY = 1 << 16;
+    TraceSpan spans[CAPACITY];
+    std::atomic<size_t> count{0};
+    std::atomic<uint64_t> dropped{0};
+    const char* thread_name = nullptr;
+    unsigned tid = 0;
+    TraceBuffer* next = nullptr;
+};
+
+static std::atomic<bool> trace_enabled{false};
+static std::atomic<TraceBuffer*> trace_buffers{nullptr};
+static std::atomic<unsigned> trace_next_tid{1};
+static uint64_t trace_tsc0;
+static std::chrono::steady_clock::time_point trace_time0;
+
+// Buffers outlive their threads so a dump after join still sees them
+static TraceBuffer* trace_thread_buffer() {
+    thread_local TraceBuffer* mine = nullptr;
+    if (!mine) {
+        mine = new TraceBuffer();
+        mine->tid = trace_next_tid.fetch_add(1);
+        mine->next = trace_buffers.load(std::memory_order_relaxed);
+        while (!trace_buffers.compare_exchange_weak(mine->next, mine, std::memory_order_release)) {}
+    }
+    return mine;
+}
+
+void sqrt_trace_start() {
+    trace_tsc0 = trace_clock();
+    trace_time0 = std::chrono::steady_clock::now();
+    trace_enabled.store(true, std::memory_order_release);
+}
+
+// Names the calling thread in the timeline (string literal)
+void sqrt_trace_thread_name(const char* name) {
+    if (trace_enabled.load(std::memory_order_relaxed)) trace_thread_buffer()->thread_name = name;
+}
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, uint64_t arg = 0) : name(name), arg(arg) {
+        if (trace_enabled.load(std::memory_order_relaxed)) begin = trace_clock();
+    }
+    ~TraceScope() {
+        if (!begin) return;
+        uint64_t end = trace_clock();
+        TraceBuffer* buf = trace_thread_buffer();
+        size_t i = buf->count.load(std::memory_order_relaxed);
+        if (i == TraceBuffer::CAPACITY) {
+            buf->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buf->spans[i] = TraceSpan{name, begin, end, arg};
+        buf->count.store(i + 1, std::memory_order_release);
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    uint64_t arg;
+    uint64_t begin = 0;
+};
+
+// Writes every span recorded so far as Chrome trace-event JSON
+bool sqrt_trace_dump(const char* path) {
+    if (!trace_enabled.load(std::memory_order_acquire)) return false;
+    uint64_t tsc1 = trace_clock();
+    double elapsed_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - trace_time0).count();
+    double ticks_per_us = elapsed_us > 0 ? (double)(tsc1 - trace_tsc0) / elapsed_us : 1.0;
+
+    FILE* f = std::fopen(path, "w");
+    if (!f) return false;
+    std::fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    const char* sep = "";
+    uint64_t dropped = 0;
+    for (TraceBuffer* b = trace_buffers.load(std::memory_order_acquire); b; b = b->next) {
+        std::fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+                     sep, b->tid, b->thread_name ? b->thread_name : "thread", b->tid);
+        sep = ",\n";
+        size_t n = b->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < n; i++) {
+            const TraceSpan& s = b->spans[i];
+            std::fprintf(f, "%s{\"name\":\"%s\",\"cat\":\"sqrt\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                            "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"n\":%llu}}",
+                         sep, s.name, b->tid, (double)(int64_t)(s.begin - trace_tsc0) / ticks_per_us,
+                         (double)(s.end - s.begin) / ticks_per_us, (unsigned long long)s.arg);
+        }
+        dropped += b->dropped.load(std::memory_order_relaxed);
+    }
+    std::fprintf(f, "\n]}\n");
+    bool ok = std::fclose(f) == 0;
+    if (dropped) std::fprintf(stderr, "sqrt trace: %llu spans dropped (buffers full)\n", (unsigned long long)dropped);
+    return ok;
+}
 
 // Method 1: Standard Newton-Raphson
 double sqrt_newton(double x) {
+    SQRT_COUNT_SCALAR(KERNEL_NEWTON, x);
     if (x < 0) return NAN;
     if (x == 0) return 0;
     
@@ -20,6 +350,7 @@ double sqrt_newton(double x) {
 
 // Method 2: Binary Search (slow, reference)
 double sqrt_binary(double x) {
+    SQRT_COUNT_SCALAR(KERNEL_BINARY, x);
     if (x < 0) return NAN;
     if (x == 0) return 0;
     
@@ -36,6 +367,7 @@ double sqrt_binary(double x) {
 // **THIS IS THE WINNER**
 // Uses hardware instruction for 1/sqrt(x), then multiplies by x
 float sqrt_sse_fast(float x) {
+    SQRT_COUNT_SCALAR(KERNEL_SSE_FAST, x);
     if (x < 0) return NAN;
     if (x == 0) return 0;
     
@@ -60,6 +392,7 @@ float sqrt_sse_fast(float x) {
 
 // Method 4: Bit manipulation + Newton (Carmack-inspired)
 float sqrt_bithack(float x) {
+    SQRT_COUNT_SCALAR(KERNEL_BITHACK, x);
     if (x < 0) return NAN;
     if (x == 0) return 0;
     
@@ -78,6 +411,7 @@ float sqrt_bithack(float x) {
 
 // Method 5: SSE exact sqrt (uses sqrtss instruction)
 float sqrt_sse_exact(float x) {
+    SQRT_COUNT_SCALAR(KERNEL_SSE_EXACT, x);
     if (x < 0) return NAN;
     if (x == 0) return 0;
     
@@ -88,6 +422,7 @@ float sqrt_sse_exact(float x) {
 
 // Method 6: Optimal production method - SSE with perfect initial guess
 double sqrt_optimal(double x) {
+    SQRT_COUNT_SCALAR(KERNEL_OPTIMAL, x);
     if (x < 0) return NAN;
     if (x == 0) return 0;
     if (x == 1) return 1;
@@ -104,6 +439,778 @@ double sqrt_optimal(double x) {
     return guess;
 }
 
+// ==================== BATCH KERNELS ====================
+// Array versions of the methods above. With AVX2 each loop handles 4 doubles
+// or 8 floats per iteration and the tail is padded into one extra vector, so
+// every element goes through the same instruction sequence. Without AVX2 the
+// scalar methods are used.
+
+enum SqrtTier {
+    SQRT_EXACT,    // sqrtpd / sqrtps, correctly rounded
+    SQRT_OPTIMAL,  // bit-hack seed + 2 Newton steps (sqrt_optimal, sqrt_bithack)
+    SQRT_FAST      // rsqrt + 1 Newton step (sqrt_sse_fast)
+};
+
+const char* tier_name(SqrtTier tier) {
+    switch (tier) {
+    case SQRT_EXACT:   return "exact";
+    case SQRT_OPTIMAL: return "optimal";
+    case SQRT_FAST:    return "fast";
+    }
+    return "?";
+}
+
+bool parse_tier(const char* s, SqrtTier* tier) {
+    for (SqrtTier t : {SQRT_EXACT, SQRT_OPTIMAL, SQRT_FAST}) {
+        if (std::strcmp(s, tier_name(t)) == 0) { *tier = t; return true; }
+    }
+    return false;
+}
+
+#if defined(__AVX2__)
+// Packed sqrt_optimal: same seed, same Newton steps, same special cases.
+// Checked = false drops the special cases for inputs known to be positive,
+// normal and finite (see sqrt_batch_normal).
+template <bool Checked = true>
+static inline __m256d sqrt_optimal_pd(__m256d x) {
+    __m256i bits = _mm256_castpd_si256(x);
+    bits = _mm256_add_epi64(_mm256_srli_epi64(bits, 1),
+                            _mm256_set1_epi64x((long long)(0x3ff0000000000000ULL >> 1)));
+    __m256d guess = _mm256_castsi256_pd(bits);
+
+    const __m256d half = _mm256_set1_pd(0.5);
+    guess = _mm256_mul_pd(half, _mm256_add_pd(guess, _mm256_div_pd(x, guess)));
+    guess = _mm256_mul_pd(half, _mm256_add_pd(guess, _mm256_div_pd(x, guess)));
+
+    if (!Checked) return guess;
+
+    // x < 0 -> NaN, x == 0 -> 0 (x == 1 already comes out as exactly 1)
+    const __m256d zero = _mm256_setzero_pd();
+    guess = _mm256_blendv_pd(guess, _mm256_set1_pd(NAN), _mm256_cmp_pd(x, zero, _CMP_LT_OQ));
+    return _mm256_andnot_pd(_mm256_cmp_pd(x, zero, _CMP_EQ_OQ), guess);
+}
+
+// Packed sqrt_bithack
+template <bool Checked = true>
+static inline __m256 sqrt_optimal_ps(__m256 x) {
+    __m256i bits = _mm256_castps_si256(x);
+    bits = _mm256_add_epi32(_mm256_srli_epi32(bits, 1), _mm256_set1_epi32((1 << 29) - (1 << 22)));
+    __m256 guess = _mm256_castsi256_ps(bits);
+
+    const __m256 half = _mm256_set1_ps(0.5f);
+    guess = _mm256_mul_ps(half, _mm256_add_ps(guess, _mm256_div_ps(x, guess)));
+    guess = _mm256_mul_ps(half, _mm256_add_ps(guess, _mm256_div_ps(x, guess)));
+
+    if (!Checked) return guess;
+
+    const __m256 zero = _mm256_setzero_ps();
+    guess = _mm256_blendv_ps(guess, _mm256_set1_ps(NAN), _mm256_cmp_ps(x, zero, _CMP_LT_OQ));
+    return _mm256_andnot_ps(_mm256_cmp_ps(x, zero, _CMP_EQ_OQ), guess);
+}
+
+// Packed sqrt_sse_fast. rsqrt only works for normal floats, so zero,
+// negative, subnormal, inf and NaN lanes are rare enough to patch with sqrtps.
+template <bool Checked = true>
+static inline __m256 sqrt_fast_ps(__m256 x) {
+    __m256 y = _mm256_rsqrt_ps(x);
+
+    // y = y * (1.5 - 0.5 * x * y * y)
+    __m256 x_half = _mm256_mul_ps(_mm256_set1_ps(0.5f), x);
+    __m256 temp = _mm256_mul_ps(x_half, _mm256_mul_ps(y, y));
+    y = _mm256_mul_ps(y, _mm256_sub_ps(_mm256_set1_ps(1.5f), temp));
+    __m256 result = _mm256_mul_ps(x, y);
+    if (!Checked) return result;
+
+    __m256 bad = _mm256_or_ps(_mm256_cmp_ps(x, _mm256_set1_ps(FLT_MIN), _CMP_NGE_UQ),
+                              _mm256_cmp_ps(x, _mm256_set1_ps(FLT_MAX), _CMP_GT_OQ));
+    if (!_mm256_testz_ps(bad, bad)) result = _mm256_blendv_ps(result, _mm256_sqrt_ps(x), bad);
+    return result;
+}
+
+// Double version of the rsqrt path: the estimate comes from rsqrtps and the
+// Newton step runs in double. Lanes outside the float range fall back to sqrtpd.
+template <bool Checked = true>
+static inline __m256d sqrt_fast_pd(__m256d x) {
+    __m256d y = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(x)));
+
+    __m256d x_half = _mm256_mul_pd(_mm256_set1_pd(0.5), x);
+    __m256d temp = _mm256_mul_pd(x_half, _mm256_mul_pd(y, y));
+    y = _mm256_mul_pd(y, _mm256_sub_pd(_mm256_set1_pd(1.5), temp));
+    __m256d result = _mm256_mul_pd(x, y);
+    if (!Checked) return result;
+
+    __m256d bad = _mm256_or_pd(_mm256_cmp_pd(x, _mm256_set1_pd(FLT_MIN), _CMP_NGE_UQ),
+                               _mm256_cmp_pd(x, _mm256_set1_pd(FLT_MAX), _CMP_GT_OQ));
+    if (!_mm256_testz_pd(bad, bad)) result = _mm256_blendv_pd(result, _mm256_sqrt_pd(x), bad);
+    return result;
+}
+
+template <class Kernel>
+static void batch_pd(const double* in, double* out, size_t n, Kernel kernel) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, kernel(_mm256_loadu_pd(in + i)));
+    }
+    if (i < n) {
+        alignas(32) double tmp[4] = {1.0, 1.0, 1.0, 1.0};
+        std::memcpy(tmp, in + i, (n - i) * sizeof(double));
+        _mm256_store_pd(tmp, kernel(_mm256_load_pd(tmp)));
+        std::memcpy(out + i, tmp, (n - i) * sizeof(double));
+    }
+}
+
+template <class Kernel>
+static void batch_ps(const float* in, float* out, size_t n, Kernel kernel) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, kernel(_mm256_loadu_ps(in + i)));
+    }
+    if (i < n) {
+        alignas(32) float tmp[8] = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f};
+        std::memcpy(tmp, in + i, (n - i) * sizeof(float));
+        _mm256_store_ps(tmp, kernel(_mm256_load_ps(tmp)));
+        std::memcpy(out + i, tmp, (n - i) * sizeof(float));
+    }
+}
+#endif
+
+// out[i] = sqrt(in[i]); in and out may be the same array
+void sqrt_batch(const double* in, double* out, size_t n, SqrtTier tier = SQRT_EXACT) {
+    TraceScope span(KERNEL_NAMES[KERNEL_BATCH_F64], n);
+    SQRT_PROBE3(batch_entry, (int)KERNEL_BATCH_F64, n, (int)tier);
+#if defined(__AVX2__)
+    SQRT_PROBE3(dispatch, (int)KERNEL_BATCH_F64, (int)tier, 1);
+    SQRT_COUNT_BATCH(KERNEL_BATCH_F64, in, n, tier, 4);
+    switch (tier) {
+    case SQRT_EXACT:   batch_pd(in, out, n, [](__m256d x) { return _mm256_sqrt_pd(x); }); break;
+    case SQRT_OPTIMAL: batch_pd(in, out, n, sqrt_optimal_pd<>); break;
+    case SQRT_FAST:    batch_pd(in, out, n, sqrt_fast_pd<>); break;
+    }
+#else
+    SQRT_PROBE3(dispatch, (int)KERNEL_BATCH_F64, (int)tier, 0);
+    SQRT_COUNT_BATCH(KERNEL_BATCH_F64, in, n, tier, 1);
+    for (size_t i = 0; i < n; i++) {
+        switch (tier) {
+        case SQRT_EXACT:   out[i] = std::sqrt(in[i]); break;
+        case SQRT_OPTIMAL: out[i] = sqrt_optimal(in[i]); break;
+        // Outside the float range the rsqrt estimate is lost, as in sqrt_fast_pd
+        case SQRT_FAST:
+            out[i] = in[i] >= FLT_MIN && in[i] <= FLT_MAX ? sqrt_sse_fast((float)in[i]) : std::sqrt(in[i]);
+            break;
+        }
+    }
+#endif
+    SQRT_PROBE3(batch_exit, (int)KERNEL_BATCH_F64, n, (int)tier);
+}
+
+void sqrt_batch(const float* in, float* out, size_t n, SqrtTier tier = SQRT_EXACT) {
+    TraceScope span(KERNEL_NAMES[KERNEL_BATCH_F32], n);
+    SQRT_PROBE3(batch_entry, (int)KERNEL_BATCH_F32, n, (int)tier);
+#if defined(__AVX2__)
+    SQRT_PROBE3(dispatch, (int)KERNEL_BATCH_F32, (int)tier, 1);
+    SQRT_COUNT_BATCH(KERNEL_BATCH_F32, in, n, tier, 8);
+    switch (tier) {
+    case SQRT_EXACT:   batch_ps(in, out, n, [](__m256 x) { return _mm256_sqrt_ps(x); }); break;
+    case SQRT_OPTIMAL: batch_ps(in, out, n, sqrt_optimal_ps<>); break;
+    case SQRT_FAST:    batch_ps(in, out, n, sqrt_fast_ps<>); break;
+    }
+#else
+    SQRT_PROBE3(dispatch, (int)KERNEL_BATCH_F32, (int)tier, 0);
+    SQRT_COUNT_BATCH(KERNEL_BATCH_F32, in, n, tier, 1);
+    for (size_t i = 0; i < n; i++) {
+        switch (tier) {
+        case SQRT_EXACT:   out[i] = sqrt_sse_exact(in[i]); break;
+        case SQRT_OPTIMAL: out[i] = sqrt_bithack(in[i]); break;
+        case SQRT_FAST:    out[i] = sqrt_sse_fast(in[i]); break;
+        }
+    }
+#endif
+    SQRT_PROBE3(batch_exit, (int)KERNEL_BATCH_F32, n, (int)tier);
+}
+
+// Like sqrt_batch, for inputs known to be positive, normal and finite (and
+// within the float exponent range for SQRT_FAST): no special-case handling.
+void sqrt_batch_normal(const double* in, double* out, size_t n, SqrtTier tier = SQRT_EXACT) {
+    TraceScope span(KERNEL_NAMES[KERNEL_NORMAL_F64], n);
+    SQRT_PROBE3(batch_entry, (int)KERNEL_NORMAL_F64, n, (int)tier);
+#if defined(__AVX2__)
+    SQRT_PROBE3(dispatch, (int)KERNEL_NORMAL_F64, (int)tier, 1);
+    SQRT_COUNT_BATCH(KERNEL_NORMAL_F64, in, n, tier, 4);
+    switch (tier) {
+    case SQRT_EXACT:   batch_pd(in, out, n, [](__m256d x) { return _mm256_sqrt_pd(x); }); break;
+    case SQRT_OPTIMAL: batch_pd(in, out, n, sqrt_optimal_pd<false>); break;
+    case SQRT_FAST:    batch_pd(in, out, n, sqrt_fast_pd<false>); break;
+    }
+#else
+    SQRT_PROBE3(dispatch, (int)KERNEL_NORMAL_F64, (int)tier, 0);
+    sqrt_batch(in, out, n, tier);
+#endif
+    SQRT_PROBE3(batch_exit, (int)KERNEL_NORMAL_F64, n, (int)tier);
+}
+
+void sqrt_batch_normal(const float* in, float* out, size_t n, SqrtTier tier = SQRT_EXACT) {
+    TraceScope span(KERNEL_NAMES[KERNEL_NORMAL_F32], n);
+    SQRT_PROBE3(batch_entry, (int)KERNEL_NORMAL_F32, n, (int)tier);
+#if defined(__AVX2__)
+    SQRT_PROBE3(dispatch, (int)KERNEL_NORMAL_F32, (int)tier, 1);
+    SQRT_COUNT_BATCH(KERNEL_NORMAL_F32, in, n, tier, 8);
+    switch (tier) {
+    case SQRT_EXACT:   batch_ps(in, out, n, [](__m256 x) { return _mm256_sqrt_ps(x); }); break;
+    case SQRT_OPTIMAL: batch_ps(in, out, n, sqrt_optimal_ps<false>); break;
+    case SQRT_FAST:    batch_ps(in, out, n, sqrt_fast_ps<false>); break;
+    }
+#else
+    SQRT_PROBE3(dispatch, (int)KERNEL_NORMAL_F32, (int)tier, 0);
+    sqrt_batch(in, out, n, tier);
+#endif
+    SQRT_PROBE3(batch_exit, (int)KERNEL_NORMAL_F32, n, (int)tier);
+}
+
+// Precision-converting batches: the conversion is fused into the root, so
+// there is no intermediate array and each element crosses memory once.
+//
+// float -> double widens exactly and runs the tier's double kernel; results
+// match sqrt_batch on a widened copy bit for bit.
+//
+// double -> float: rounding the root to double and then to float is one ulp
+// off when the double root lands exactly on a float midpoint (x = M^2 +- ulp
+// for a 25-bit M). The exact tier moves an inexact double root with an even
+// last bit one ulp toward the true root, i.e. rounds it to odd; float
+// midpoints are even at double precision, so the narrowing is then correctly
+// rounded. The optimal and fast tiers only owe float accuracy, so vectors
+// whose lanes all lie in the float range are narrowed first and run through
+// the 8-wide float kernels; other vectors take the double kernel.
+
+// Correctly rounded float square root of a double. The residual only
+// underflows to zero for roots far below the float subnormals.
+inline float sqrt_to_float(double x) {
+    double r = std::sqrt(x);
+    double residual = std::fma(r, r, -x);  // exact sign; NaN for inf and NaN roots
+    uint64_t bits;
+    std::memcpy(&bits, &r, sizeof(bits));
+    if (!(bits & 1) && (residual < 0 || residual > 0)) {
+        bits = residual < 0 ? bits + 1 : bits - 1;
+        std::memcpy(&r, &bits, sizeof(r));
+    }
+    return (float)r;
+}
+
+static inline bool in_float_range(double x) { return x >= FLT_MIN && x <= FLT_MAX; }
+
+#if defined(__AVX2__)
+static inline __m128 sqrt_to_float_pd(__m256d x) {
+#if defined(__FMA__)
+    __m256d r = _mm256_sqrt_pd(x);
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d residual = _mm256_fmsub_pd(r, r, x);
+    __m256i bits = _mm256_castpd_si256(r);
+    __m256i even = _mm256_cmpeq_epi64(_mm256_and_si256(bits, _mm256_set1_epi64x(1)), _mm256_setzero_si256());
+    __m256i up = _mm256_and_si256(even, _mm256_castpd_si256(_mm256_cmp_pd(residual, zero, _CMP_LT_OQ)));
+    __m256i down = _mm256_and_si256(even, _mm256_castpd_si256(_mm256_cmp_pd(residual, zero, _CMP_GT_OQ)));
+    bits = _mm256_add_epi64(_mm256_sub_epi64(bits, up), down);  // masks are -1: up adds one, down subtracts
+    return _mm256_cvtpd_ps(_mm256_castsi256_pd(bits));
+#else
+    alignas(32) double lanes[4];
+    alignas(16) float roots[4];
+    _mm256_store_pd(lanes, x);
+    for (int k = 0; k < 4; k++) roots[k] = sqrt_to_float(lanes[k]);
+    return _mm_load_ps(roots);
+#endif
+}
+
+template <class Kernel>
+static void batch_widen(const float* in, double* out, size_t n, Kernel kernel) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, kernel(_mm256_cvtps_pd(_mm_loadu_ps(in + i))));
+    }
+    if (i < n) {
+        alignas(16) float tmp[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+        alignas(32) double res[4];
+        std::memcpy(tmp, in + i, (n - i) * sizeof(float));
+        _mm256_store_pd(res, kernel(_mm256_cvtps_pd(_mm_load_ps(tmp))));
+        std::memcpy(out + i, res, (n - i) * sizeof(double));
+    }
+}
+
+// Wide: double kernel with narrowed result, 4 lanes. Narrow: float kernel on
+// 8 narrowed lanes, used when Narrowing and every lane is in the float range.
+template <bool Narrowing, class Wide, class Narrow>
+static void batch_narrow(const double* in, float* out, size_t n, Wide wide, Narrow narrow) {
+    auto eight = [&](const double* src, float* dst) {
+        __m256d a = _mm256_loadu_pd(src), b = _mm256_loadu_pd(src + 4);
+        if (Narrowing) {
+            const __m256d lo = _mm256_set1_pd(FLT_MIN), hi = _mm256_set1_pd(FLT_MAX);
+            __m256d bad = _mm256_or_pd(_mm256_or_pd(_mm256_cmp_pd(a, lo, _CMP_NGE_UQ), _mm256_cmp_pd(a, hi, _CMP_GT_OQ)),
+                                       _mm256_or_pd(_mm256_cmp_pd(b, lo, _CMP_NGE_UQ), _mm256_cmp_pd(b, hi, _CMP_GT_OQ)));
+            if (_mm256_testz_pd(bad, bad)) {
+                _mm256_storeu_ps(dst, narrow(_mm256_set_m128(_mm256_cvtpd_ps(b), _mm256_cvtpd_ps(a))));
+                return;
+            }
+        }
+        _mm_storeu_ps(dst, wide(a));
+        _mm_storeu_ps(dst + 4, wide(b));
+    };
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) eight(in + i, out + i);
+    if (i < n) {
+        double tmp[8] = {1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0};
+        float res[8];
+        std::memcpy(tmp, in + i, (n - i) * sizeof(double));
+        eight(tmp, res);
+        std::memcpy(out + i, res, (n - i) * sizeof(float));
+    }
+}
+#endif
+
+// out[i] = sqrt((double)in[i])
+void sqrt_batch(const float* in, double* out, size_t n, SqrtTier tier = SQRT_EXACT) {
+    TraceScope span(KERNEL_NAMES[KERNEL_WIDEN], n);
+    SQRT_PROBE3(batch_entry, (int)KERNEL_WIDEN, n, (int)tier);
+#if defined(__AVX2__)
+    SQRT_PROBE3(dispatch, (int)KERNEL_WIDEN, (int)tier, 1);
+    SQRT_COUNT_BATCH(KERNEL_WIDEN, in, n, tier, 4);
+    switch (tier) {
+    case SQRT_EXACT:   batch_widen(in, out, n, [](__m256d x) { return _mm256_sqrt_pd(x); }); break;
+    case SQRT_OPTIMAL: batch_widen(in, out, n, sqrt_optimal_pd<>); break;
+    case SQRT_FAST:    batch_widen(in, out, n, sqrt_fast_pd<>); break;
+    }
+#else
+    SQRT_PROBE3(dispatch, (int)KERNEL_WIDEN, (int)tier, 0);
+    SQRT_COUNT_BATCH(KERNEL_WIDEN, in, n, tier, 1);
+    for (size_t i = 0; i < n; i++) {
+        switch (tier) {
+        case SQRT_EXACT:   out[i] = std::sqrt((double)in[i]); break;
+        case SQRT_OPTIMAL: out[i] = sqrt_optimal(in[i]); break;
+        case SQRT_FAST:    out[i] = sqrt_sse_fast(in[i]); break;
+        }
+    }
+#endif
+    SQRT_PROBE3(batch_exit, (int)KERNEL_WIDEN, n, (int)tier);
+}
+
+// out[i] = (float)sqrt(in[i]); exact is correctly rounded to float
+void sqrt_batch(const double* in, float* out, size_t n, SqrtTier tier = SQRT_EXACT) {
+    TraceScope span(KERNEL_NAMES[KERNEL_NARROW], n);
+    SQRT_PROBE3(batch_entry, (int)KERNEL_NARROW, n, (int)tier);
+#if defined(__AVX2__)
+    SQRT_PROBE3(dispatch, (int)KERNEL_NARROW, (int)tier, 1);
+    SQRT_COUNT_BATCH(KERNEL_NARROW, in, n, tier, 8);
+    auto none = [](__m256 x) { return x; };
+    switch (tier) {
+    case SQRT_EXACT:
+        batch_narrow<false>(in, out, n, sqrt_to_float_pd, none);
+        break;
+    case SQRT_OPTIMAL:
+        batch_narrow<true>(in, out, n, [](__m256d x) { return _mm256_cvtpd_ps(sqrt_optimal_pd<>(x)); },
+                           sqrt_optimal_ps<false>);
+        break;
+    case SQRT_FAST:
+        batch_narrow<true>(in, out, n, [](__m256d x) { return _mm256_cvtpd_ps(sqrt_fast_pd<>(x)); },
+                           sqrt_fast_ps<false>);
+        break;
+    }
+#else
+    SQRT_PROBE3(dispatch, (int)KERNEL_NARROW, (int)tier, 0);
+    SQRT_COUNT_BATCH(KERNEL_NARROW, in, n, tier, 1);
+    for (size_t i = 0; i < n; i++) {
+        switch (tier) {
+        case SQRT_EXACT:   out[i] = sqrt_to_float(in[i]); break;
+        case SQRT_OPTIMAL: out[i] = in_float_range(in[i]) ? sqrt_bithack((float)in[i]) : (float)sqrt_optimal(in[i]); break;
+        case SQRT_FAST:    out[i] = in_float_range(in[i]) ? sqrt_sse_fast((float)in[i]) : (float)std::sqrt(in[i]); break;
+        }
+    }
+#endif
+    SQRT_PROBE3(batch_exit, (int)KERNEL_NARROW, n, (int)tier);
+}
+
+// ==================== BENCHMARK STATISTICS ====================
+// One timing run per kernel can't tell a 1.08x speedup from noise. The speed
+// test instead runs every kernel in each of several rounds, in a fresh random
+// order per round so drift (frequency, thermals, neighbours) spreads evenly.
+// Each kernel's samples are trimmed with Tukey fences and summarized by their
+// median with a bootstrap CI. A speedup is claimed only when a two-sided
+// Mann-Whitney U test rejects "same distribution" and the bootstrap CI of the
+// ratio of medians excludes 1.
+
+struct SampleStats {
+    double median, lo, hi;  // 95% bootstrap CI of the median
+    size_t kept, rejected;
+};
+
+struct Comparison {
+    double ratio, lo, hi;  // base median / other median, with 95% bootstrap CI
+    double p;              // Mann-Whitney two-sided p-value
+    bool significant;
+};
+
+static double median_of(std::vector<double>& v) {
+    size_t mid = v.size() / 2;
+    std::nth_element(v.begin(), v.begin() + mid, v.end());
+    double m = v[mid];
+    if (v.size() % 2 == 0) m = (m + *std::max_element(v.begin(), v.begin() + mid)) / 2;
+    return m;
+}
+
+static double quantile_sorted(const std::vector<double>& sorted, double q) {
+    double pos = q * (double)(sorted.size() - 1);
+    size_t i = (size_t)pos;
+    if (i + 1 >= sorted.size()) return sorted.back();
+    return sorted[i] + (pos - (double)i) * (sorted[i + 1] - sorted[i]);
+}
+
+// Drops samples outside [Q1 - 1.5 IQR, Q3 + 1.5 IQR]
+std::vector<double> reject_outliers(std::vector<double> samples) {
+    if (samples.size() < 4) return samples;
+    std::sort(samples.begin(), samples.end());
+    double q1 = quantile_sorted(samples, 0.25), q3 = quantile_sorted(samples, 0.75);
+    double lo = q1 - 1.5 * (q3 - q1), hi = q3 + 1.5 * (q3 - q1);
+    samples.erase(std::remove_if(samples.begin(), samples.end(), [&](double x) { return x < lo || x > hi; }),
+                  samples.end());
+    return samples;
+}
+
+static const int BOOTSTRAP_RESAMPLES = 2000;
+
+static double resampled_median(const std::vector<double>& v, std::mt19937_64& rng, std::vector<double>& scratch) {
+    std::uniform_int_distribution<size_t> pick(0, v.size() - 1);
+    scratch.resize(v.size());
+    for (double& x : scratch) x = v[pick(rng)];
+    return median_of(scratch);
+}
+
+SampleStats summarize(const std::vector<double>& samples) {
+    std::vector<double> kept = reject_outliers(samples);
+    SampleStats s;
+    s.kept = kept.size();
+    s.rejected = samples.size() - kept.size();
+    std::vector<double> tmp = kept, scratch, medians(BOOTSTRAP_RESAMPLES);
+    s.median = median_of(tmp);
+    std::mt19937_64 rng(0x5eed);
+    for (double& m : medians) m = resampled_median(kept, rng, scratch);
+    std::sort(medians.begin(), medians.end());
+    s.lo = quantile_sorted(medians, 0.025);
+    s.hi = quantile_sorted(medians, 0.975);
+    return s;
+}
+
+// Two-sided p-value of the Mann-Whitney U test (normal approximation with tie
+// correction; fine from about 8 samples per side)
+double mann_whitney_p(const std::vector<double>& a, const std::vector<double>& b) {
+    const size_t n1 = a.size(), n2 = b.size(), n = n1 + n2;
+    std::vector<std::pair<double, int>> all;
+    all.reserve(n);
+    for (double x : a) all.push_back({x, 0});
+    for (double x : b) all.push_back({x, 1});
+    std::sort(all.begin(), all.end());
+
+    double rank_sum_a = 0, tie_term = 0;
+    for (size_t i = 0; i < n;) {
+        size_t j = i;
+        while (j < n && all[j].first == all[i].first) j++;
+        double rank = (double)(i + j + 1) / 2;  // average of ranks i+1..j
+        for (size_t k = i; k < j; k++) if (all[k].second == 0) rank_sum_a += rank;
+        double t = (double)(j - i);
+        tie_term += t * t * t - t;
+        i = j;
+    }
+    double u = rank_sum_a - (double)n1 * (double)(n1 + 1) / 2;
+    double mean = (double)n1 * (double)n2 / 2;
+    double var = (double)n1 * (double)n2 / 12 * ((double)(n + 1) - tie_term / ((double)n * (double)(n - 1)));
+    if (var <= 0) return 1.0;
+    double z = (std::abs(u - mean) - 0.5) / std::sqrt(var);  // continuity correction
+    return std::min(1.0, std::erfc(std::max(0.0, z) / std::sqrt(2.0)));
+}
+
+Comparison compare_samples(const std::vector<double>& base, const std::vector<double>& other) {
+    std::vector<double> a = reject_outliers(base), b = reject_outliers(other);
+    Comparison c;
+    std::vector<double> ta = a, tb = b, scratch, ratios(BOOTSTRAP_RESAMPLES);
+    c.ratio = median_of(ta) / median_of(tb);
+    std::mt19937_64 rng(0xc0ffee);
+    for (double& r : ratios) {
+        double ma = resampled_median(a, rng, scratch);
+        r = ma / resampled_median(b, rng, scratch);
+    }
+    std::sort(ratios.begin(), ratios.end());
+    c.lo = quantile_sorted(ratios, 0.025);
+    c.hi = quantile_sorted(ratios, 0.975);
+    c.p = mann_whitney_p(a, b);
+    c.significant = c.p < 0.01 && (c.lo > 1.0 || c.hi < 1.0);
+    return c;
+}
+
+// "1.08x FASTER", "3.2x slower" or "uncertain", with the evidence
+std::string describe_comparison(const Comparison& c) {
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(2);
+    if (!c.significant) s << "uncertain: within noise, " << c.ratio << "x [" << c.lo << ", " << c.hi << "]";
+    else if (c.ratio >= 1) s << c.ratio << "x FASTER [" << c.lo << ", " << c.hi << "]";
+    else s << 1 / c.ratio << "x slower [" << 1 / c.hi << ", " << 1 / c.lo << "]";
+    s << ", p=" << std::scientific << std::setprecision(1) << c.p;
+    return s.str();
+}
+
+// A scalar kernel timed over a fixed input cycle; returns ns per call. ctx is
+// passed through to run, for kernels only known at run time (plugins).
+struct SpeedKernel {
+    const char* name;
+    double (*run)(const float* data, size_t size, int iterations, const void* ctx);
+    const void* ctx = nullptr;
+};
+
+// The speed test's methodology, shared by everything that compares against it
+static const int SPEED_ROUNDS = 21;
+static const int SPEED_ITERATIONS = 1000000;  // per kernel per round
+
+static std::vector<float> speed_test_data() {
+    std::vector<float> data;
+    for (int i = 0; i < 1000; i++) data.push_back(0.1f + i * 0.01f);
+    return data;
+}
+
+template <class Arg, class Ret, Ret (*Fn)(Arg)>
+static double speed_loop(const float* data, size_t size, int iterations, const void*) {
+    volatile Ret result;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        result = Fn(data[i % size]);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    (void)result;
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+// Runs every kernel once per round, in a new random order each round;
+// samples[k] holds kernel k's ns/call for every round
+std::vector<std::vector<double>> measure_interleaved(const SpeedKernel* kernels, size_t count, const float* data,
+                                                     size_t size, int iterations, int rounds) {
+    std::vector<std::vector<double>> samples(count);
+    std::vector<size_t> order(count);
+    for (size_t k = 0; k < count; k++) order[k] = k;
+    std::mt19937_64 rng((uint64_t)std::chrono::steady_clock::now().time_since_epoch().count());
+    for (size_t k = 0; k < count; k++) kernels[k].run(data, size, iterations / 10, kernels[k].ctx);  // warm up
+    for (int r = 0; r < rounds; r++) {
+        std::shuffle(order.begin(), order.end(), rng);
+        for (size_t k : order) {
+            TraceScope span(kernels[k].name, (uint64_t)r);
+            samples[k].push_back(kernels[k].run(data, size, iterations, kernels[k].ctx));
+        }
+    }
+    return samples;
+}
+
+static float std_sqrt_f(float x) { return std::sqrt(x); }
+
+// ==================== BENCHMARK PREFLIGHT ====================
+// Frequency scaling, turbo, a busy SMT sibling or interrupts landing on the
+// measuring core move timings by more than the differences being measured
+// (the README's 67 ms vs 62 ms is well inside clock drift). The preflight
+// checks each of these, optionally pins the calling thread, and warms up until
+// the measured core clock plateaus; the findings are printed with the results.
+// SQRT_PREFLIGHT=strict refuses to benchmark on any warning, =off skips it.
+
+enum PreflightMode { PREFLIGHT_OFF, PREFLIGHT_WARN, PREFLIGHT_STRICT };
+
+PreflightMode preflight_mode() {
+    const char* mode = std::getenv("SQRT_PREFLIGHT");
+    if (!mode) return PREFLIGHT_WARN;
+    if (!std::strcmp(mode, "off")) return PREFLIGHT_OFF;
+    if (!std::strcmp(mode, "strict")) return PREFLIGHT_STRICT;
+    return PREFLIGHT_WARN;
+}
+
+struct BenchEnvironment {
+    int cpu = -1;  // core the thread runs on
+    bool pinned = false, isolated = false;
+    std::string governor = "unknown", turbo = "unknown", smt = "unknown";
+    std::string siblings;  // SMT siblings of cpu, including itself
+    unsigned irqs = 0, irqs_total = 0;  // IRQs that may be delivered to cpu
+    double ghz = 0, ghz_spread = 0;     // plateau clock and its relative spread
+    double warmup_ms = 0;
+    bool plateaued = false;
+    std::vector<std::string> warnings;
+};
+
+static std::string read_sysfs(const std::string& path) {
+    std::ifstream f(path);
+    std::string line;
+    if (!f || !std::getline(f, line)) return "";
+    return line;
+}
+
+// Parses kernel cpu lists such as "0-3,8,10-11"
+static bool cpu_list_contains(const std::string& list, int cpu) {
+    const char* p = list.c_str();
+    while (*p) {
+        char* end;
+        long lo = std::strtol(p, &end, 10), hi = lo;
+        if (end == p) return false;
+        if (*end == '-') hi = std::strtol(end + 1, &end, 10);
+        if (cpu >= lo && cpu <= hi) return true;
+        p = *end == ',' ? end + 1 : end;
+        if (*end != ',') break;
+    }
+    return false;
+}
+
+static std::vector<int> cpu_list_parse(const std::string& list) {
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        if (cpu_list_contains(list, cpu)) cpus.push_back(cpu);
+    return cpus;
+}
+
+// Core clock from a dependent chain of 1-cycle adds, so it sees turbo and
+// throttling that the TSC hides. Returns 0 where the asm isn't available.
+static double measure_core_ghz() {
+#if defined(__x86_64__) || defined(__i386__)
+    const int ITERS = 100000;  // 10 adds each: 1M cycles
+    unsigned x = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERS; i++) {
+        __asm__ volatile("add $1, %0\n\tadd $1, %0\n\tadd $1, %0\n\tadd $1, %0\n\tadd $1, %0\n\t"
+                         "add $1, %0\n\tadd $1, %0\n\tadd $1, %0\n\tadd $1, %0\n\tadd $1, %0"
+                         : "+r"(x));
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return 10.0 * ITERS / ns;
+#else
+    return 0;
+#endif
+}
+
+BenchEnvironment benchmark_preflight(bool pin) {
+    BenchEnvironment env;
+    env.cpu = sched_getcpu();
+    if (env.cpu < 0) env.cpu = 0;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) env.pinned = CPU_COUNT(&allowed) == 1;
+    if (pin && !env.pinned) {
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(env.cpu, &one);
+        env.pinned = sched_setaffinity(0, sizeof(one), &one) == 0;
+    }
+    if (!env.pinned) env.warnings.push_back("thread is not pinned; the scheduler may migrate it mid-run");
+
+    const std::string cpu_dir = "/sys/devices/system/cpu/cpu" + std::to_string(env.cpu);
+    std::string governor = read_sysfs(cpu_dir + "/cpufreq/scaling_governor");
+    if (!governor.empty()) {
+        env.governor = governor;
+        if (governor != "performance")
+            env.warnings.push_back("cpufreq governor is '" + governor + "', not 'performance'");
+    }
+
+    std::string no_turbo = read_sysfs("/sys/devices/system/cpu/intel_pstate/no_turbo");
+    std::string boost = read_sysfs("/sys/devices/system/cpu/cpufreq/boost");
+    if (!no_turbo.empty()) env.turbo = no_turbo == "1" ? "off" : "on";
+    else if (!boost.empty()) env.turbo = boost == "1" ? "on" : "off";
+    if (env.turbo == "on") env.warnings.push_back("turbo is on; clocks follow temperature and load");
+
+    std::string smt = read_sysfs("/sys/devices/system/cpu/smt/control");
+    if (!smt.empty()) env.smt = smt;
+    env.siblings = read_sysfs(cpu_dir + "/topology/thread_siblings_list");
+    if (!env.siblings.empty() && env.siblings != std::to_string(env.cpu))
+        env.warnings.push_back("cpu " + std::to_string(env.cpu) + " shares its core with SMT siblings " + env.siblings);
+
+    env.isolated = cpu_list_contains(read_sysfs("/sys/devices/system/cpu/isolated"), env.cpu);
+    if (DIR* dir = opendir("/proc/irq")) {
+        while (dirent* e = readdir(dir)) {
+            if (e->d_name[0] < '0' || e->d_name[0] > '9') continue;
+            std::string base = std::string("/proc/irq/") + e->d_name;
+            std::string list = read_sysfs(base + "/effective_affinity_list");
+            if (list.empty()) list = read_sysfs(base + "/smp_affinity_list");
+            if (list.empty()) continue;
+            env.irqs_total++;
+            if (cpu_list_contains(list, env.cpu)) env.irqs++;
+        }
+        closedir(dir);
+    }
+    if (env.irqs > 0)
+        env.warnings.push_back(std::to_string(env.irqs) + " IRQs can be delivered to cpu " + std::to_string(env.cpu));
+
+    // Warm up until five consecutive clock samples agree within 1%
+    const int WINDOW = 5;
+    const double MAX_WARMUP_MS = 3000;
+    std::vector<double> recent;
+    auto start = std::chrono::steady_clock::now();
+    while (true) {
+        double ghz = measure_core_ghz();
+        if (ghz == 0) break;
+        recent.push_back(ghz);
+        if (recent.size() > (size_t)WINDOW) recent.erase(recent.begin());
+        env.warmup_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (recent.size() == (size_t)WINDOW) {
+            auto mm = std::minmax_element(recent.begin(), recent.end());
+            std::vector<double> tmp = recent;
+            env.ghz = median_of(tmp);
+            env.ghz_spread = (*mm.second - *mm.first) / env.ghz;
+            if (env.ghz_spread < 0.01) {
+                env.plateaued = true;
+                break;
+            }
+        }
+        if (env.warmup_ms > MAX_WARMUP_MS) break;
+    }
+    if (env.ghz > 0 && !env.plateaued) {
+        std::ostringstream s;
+        s << "core clock did not plateau within " << MAX_WARMUP_MS << " ms (spread " << std::fixed
+          << std::setprecision(1) << 100 * env.ghz_spread << "%)";
+        env.warnings.push_back(s.str());
+    }
+    return env;
+}
+
+// Re-measures the clock after a run; drift means the samples straddle a change
+void preflight_recheck(BenchEnvironment& env, std::ostream& os) {
+    if (env.ghz == 0) return;
+    std::vector<double> samples;
+    for (int i = 0; i < 5; i++) samples.push_back(measure_core_ghz());
+    double after = median_of(samples), drift = after / env.ghz - 1;
+    os << "  clock after run  " << std::fixed << std::setprecision(2) << after << " GHz (" << std::showpos
+       << std::setprecision(1) << 100 * drift << std::noshowpos << "%)\n";
+    if (std::abs(drift) > 0.02) {
+        std::ostringstream s;
+        s << "core clock drifted " << std::fixed << std::setprecision(1) << 100 * drift << "% during the run";
+        env.warnings.push_back(s.str());
+        os << "  WARNING: " << env.warnings.back() << "\n";
+    }
+}
+
+void print_environment(const BenchEnvironment& env, std::ostream& os) {
+    os << "ENVIRONMENT:\n";
+    os << "  cpu              " << env.cpu << (env.pinned ? " (pinned)" : " (not pinned)")
+       << (env.isolated ? ", isolated" : ", not isolated") << "\n";
+    os << "  governor         " << env.governor << "\n";
+    os << "  turbo            " << env.turbo << "\n";
+    os << "  SMT              " << env.smt << (env.siblings.empty() ? "" : ", siblings " + env.siblings) << "\n";
+    os << "  IRQs on cpu      " << env.irqs << " of " << env.irqs_total << "\n";
+    if (env.ghz > 0) {
+        os << "  core clock       " << std::fixed << std::setprecision(2) << env.ghz << " GHz, "
+           << (env.plateaued ? "plateau after " : "no plateau after ") << std::setprecision(0) << env.warmup_ms
+           << " ms (spread " << std::setprecision(1) << 100 * env.ghz_spread << "%)\n";
+    } else {
+        os << "  core clock       not measured on this architecture\n";
+    }
+    for (const std::string& w : env.warnings) os << "  WARNING: " << w << "\n";
+}
+
+// Runs the preflight per SQRT_PREFLIGHT and prints it; false means refuse
+bool preflight_or_refuse(bool pin, BenchEnvironment* env, std::ostream& os) {
+    PreflightMode mode = preflight_mode();
+    if (mode == PREFLIGHT_OFF) return true;
+    *env = benchmark_preflight(pin);
+    print_environment(*env, os);
+    if (mode == PREFLIGHT_STRICT && !env->warnings.empty()) {
+        os << "  refusing to benchmark (SQRT_PREFLIGHT=strict)\n\n";
+        return false;
+    }
+    os << "\n";
+    return true;
+}
+
 void comprehensive_test() {
     std::cout << "========================================\n";
     std::cout << "   COMPREHENSIVE SQRT ANALYSIS\n";
@@ -160,78 +1267,56 @@ void comprehensive_test() {
     std::cout << "  Optimal:    " << max_error_opt << "\n\n";
     
     // ==================== SPEED TEST ====================
-    const int ITERATIONS = 10000000;  // 10 million iterations
-    
-    std::cout << "SPEED TEST (" << ITERATIONS << " iterations):\n";
-    std::cout << std::string(60, '-') << "\n";
-    
+    const int ROUNDS = SPEED_ROUNDS;
+    const int ITERATIONS = SPEED_ITERATIONS;
+
+    BenchEnvironment env;
+    if (!preflight_or_refuse(true, &env, std::cout)) return;
+
+    std::cout << "SPEED TEST (" << ROUNDS << " interleaved rounds x " << ITERATIONS << " iterations, "
+              << "median ns/call [95% CI]):\n";
+    std::cout << std::string(90, '-') << "\n";
+
     // Prepare test data
-    std::vector<float> test_data;
-    for (int i = 0; i < 1000; i++) {
-        test_data.push_back(0.1f + i * 0.01f);
-    }
-    
-    // Test std::sqrt
-    auto start = std::chrono::high_resolution_clock::now();
-    volatile float result;
-    for (int i = 0; i < ITERATIONS; i++) {
-        result = std::sqrt(test_data[i % test_data.size()]);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    auto time_std = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-    
-    // Test Newton
-    start = std::chrono::high_resolution_clock::now();
-    for (int i = 0; i < ITERATIONS; i++) {
-        result = sqrt_newton(test_data[i % test_data.size()]);
-    }
-    end = std::chrono::high_resolution_clock::now();
-    auto time_newton = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-    
-    // Test SSE Fast
-    start = std::chrono::high_resolution_clock::now();
-    for (int i = 0; i < ITERATIONS; i++) {
-        result = sqrt_sse_fast(test_data[i % test_data.size()]);
-    }
-    end = std::chrono::high_resolution_clock::now();
-    auto time_sse_fast = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-    
-    // Test Bithack
-    start = std::chrono::high_resolution_clock::now();
-    for (int i = 0; i < ITERATIONS; i++) {
-        result = sqrt_bithack(test_data[i % test_data.size()]);
-    }
-    end = std::chrono::high_resolution_clock::now();
-    auto time_bithack = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-    
-    // Test SSE Exact
-    start = std::chrono::high_resolution_clock::now();
-    for (int i = 0; i < ITERATIONS; i++) {
-        result = sqrt_sse_exact(test_data[i % test_data.size()]);
-    }
-    end = std::chrono::high_resolution_clock::now();
-    auto time_sse_exact = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-    
-    // Test Optimal
-    start = std::chrono::high_resolution_clock::now();
-    for (int i = 0; i < ITERATIONS; i++) {
-        result = sqrt_optimal(test_data[i % test_data.size()]);
+    std::vector<float> test_data = speed_test_data();
+
+    const SpeedKernel kernels[] = {
+        {"std::sqrt", speed_loop<float, float, std_sqrt_f>},
+        {"Newton", speed_loop<double, double, sqrt_newton>},
+        {"SSE Fast (rsqrt)", speed_loop<float, float, sqrt_sse_fast>},
+        {"Bithack + Newton", speed_loop<float, float, sqrt_bithack>},
+        {"SSE Exact (sqrtss)", speed_loop<float, float, sqrt_sse_exact>},
+        {"Optimal", speed_loop<double, double, sqrt_optimal>},
+    };
+    const size_t KERNELS = sizeof(kernels) / sizeof(kernels[0]);
+    std::vector<std::vector<double>> samples =
+        measure_interleaved(kernels, KERNELS, test_data.data(), test_data.size(), ITERATIONS, ROUNDS);
+
+    // Every comparison is against std::sqrt (kernel 0)
+    std::vector<Comparison> vs_std(KERNELS);
+    for (size_t k = 0; k < KERNELS; k++) {
+        SampleStats s = summarize(samples[k]);
+        std::cout << std::setw(20) << (std::string(kernels[k].name) + ":") << std::fixed << std::setprecision(3)
+                  << std::setw(9) << s.median << " ns [" << s.lo << ", " << s.hi << "]";
+        if (s.rejected) std::cout << "  " << s.rejected << " outlier" << (s.rejected > 1 ? "s" : "");
+        if (k > 0) {
+            vs_std[k] = compare_samples(samples[0], samples[k]);
+            std::cout << "  " << describe_comparison(vs_std[k]);
+        }
+        std::cout << "\n";
     }
-    end = std::chrono::high_resolution_clock::now();
-    auto time_optimal = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-    
-    std::cout << std::fixed << std::setprecision(0);
-    std::cout << std::setw(20) << "std::sqrt:" << std::setw(10) << time_std << " ms\n";
-    std::cout << std::setw(20) << "Newton:" << std::setw(10) << time_newton << " ms  (" 
-              << std::setprecision(2) << (float)time_newton/time_std << "x slower)\n";
-    std::cout << std::setw(20) << "SSE Fast (rsqrt):" << std::setw(10) << std::setprecision(0) << time_sse_fast << " ms  (" 
-              << std::setprecision(2) << (float)time_std/time_sse_fast << "x FASTER)\n";
-    std::cout << std::setw(20) << "Bithack + Newton:" << std::setw(10) << std::setprecision(0) << time_bithack << " ms  (" 
-              << std::setprecision(2) << (float)time_std/time_bithack << "x FASTER)\n";
-    std::cout << std::setw(20) << "SSE Exact (sqrtss):" << std::setw(10) << std::setprecision(0) << time_sse_exact << " ms  (" 
-              << std::setprecision(2) << (float)time_std/time_sse_exact << "x FASTER)\n";
-    std::cout << std::setw(20) << "Optimal:" << std::setw(10) << std::setprecision(0) << time_optimal << " ms  (" 
-              << std::setprecision(2) << (float)time_std/time_optimal << "x FASTER)\n";
+    if (preflight_mode() != PREFLIGHT_OFF) preflight_recheck(env, std::cout);
+    const Comparison& cmp_sse_fast = vs_std[2];
+    const Comparison& cmp_bithack = vs_std[3];
+    const Comparison& cmp_optimal = vs_std[5];
+    auto versus_std = [](const Comparison& c) {
+        std::ostringstream s;
+        s << std::fixed << std::setprecision(1);
+        if (!c.significant) s << "no measurable difference from std::sqrt";
+        else if (c.ratio >= 1) s << c.ratio << "x faster than std::sqrt";
+        else s << 1 / c.ratio << "x slower than std::sqrt";
+        return s.str();
+    };
     
     // ==================== KEY FINDINGS ====================
     std::cout << "\n========================================\n";
@@ -240,13 +1325,13 @@ void comprehensive_test() {
     
     std::cout << "1. SSE RSQRT + NEWTON (sqrt_sse_fast):\n";
     std::cout << "   ✓ Uses hardware rsqrtss instruction\n";
-    std::cout << "   ✓ " << std::setprecision(1) << (float)time_std/time_sse_fast << "x faster than std::sqrt\n";
+    std::cout << "   ✓ " << versus_std(cmp_sse_fast) << "\n";
     std::cout << "   ✓ Error: " << std::scientific << max_error_sse << " (acceptable for many applications)\n";
     std::cout << "   ✓ Used in game engines, graphics pipelines\n\n";
     
     std::cout << "2. BIT MANIPULATION + NEWTON (sqrt_bithack):\n";
     std::cout << "   ✓ IEEE 754 bit-level tricks for initial guess\n";
-    std::cout << "   ✓ " << std::fixed << std::setprecision(1) << (float)time_std/time_bithack << "x faster than std::sqrt\n";
+    std::cout << "   ✓ " << versus_std(cmp_bithack) << "\n";
     std::cout << "   ✓ Portable, no special instructions needed\n";
     std::cout << "   ✓ Good for embedded systems\n\n";
     
@@ -254,7 +1339,7 @@ void comprehensive_test() {
     std::cout << "   ✓ Best balance: speed + accuracy\n";
     std::cout << "   ✓ Bit manipulation for perfect initial guess\n";
     std::cout << "   ✓ Only 2 Newton iterations vs 5-7\n";
-    std::cout << "   ✓ " << (float)time_std/time_optimal << "x faster with near-perfect accuracy\n\n";
+    std::cout << "   ✓ " << versus_std(cmp_optimal) << ", near-perfect accuracy\n\n";
     
     std::cout << "WHY THIS MATTERS FOR HFT's:\n";
     std::cout << "  • HFT needs predictable, low-latency operations\n";
@@ -269,7 +1354,5304 @@ void comprehensive_test() {
     std::cout << "  ✓ Optimal: Best initial guess, 2 iterations, near-perfect accuracy\n";
 }
 
-int main() {
+// ==================== THREAD POOL ====================
+// Fixed set of worker threads that split one job into numbered tasks. Jobs
+// live on the submitting thread's stack and are claimed under the pool mutex,
+// so submitting work never allocates. The caller works on its own job too.
+// post() is the non-blocking form: the job lives in caller-owned storage and
+// its completion callback runs on whichever worker finishes the last task.
+//
+// ThreadPoolOptions::on_start runs first on every worker thread (worker 1..n-1;
+// the submitting thread counts as 0), e.g. to pin it. With spin set, idle
+// workers and waiting submitters poll instead of sleeping on the condition
+// variables and take the mutex with try_lock, so dispatch makes no system
+// calls; that costs a busy core per worker.
+
+struct ThreadPoolOptions {
+    void (*on_start)(void* ctx, unsigned worker) = nullptr;
+    void* ctx = nullptr;
+    bool spin = false;
+};
+
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads, const ThreadPoolOptions& options = ThreadPoolOptions())
+        : spin(options.spin) {
+        for (unsigned t = 1; t < threads; t++) {
+            workers.emplace_back([this, options, t] {
+                if (options.on_start) options.on_start(options.ctx, t);
+                worker_loop();
+            });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            stopping = true;
+            stop_spinning.store(true, std::memory_order_relaxed);
+        }
+        work_cv.notify_all();
+        for (std::thread& w : workers) w.join();
+    }
+
+    unsigned size() const { return (unsigned)workers.size() + 1; }
+
+    // Runs fn(task) for every task in [0, tasks) and returns when all are done
+    template <class F>
+    void parallel_for(size_t tasks, F&& fn) {
+        if (tasks == 0) return;
+        if (workers.empty() || tasks == 1) {
+            for (size_t t = 0; t < tasks; t++) fn(t);
+            return;
+        }
+        typedef typename std::remove_reference<F>::type Fn;
+        Job job;
+        job.run = [](void* ctx, size_t task) { (*static_cast<Fn*>(ctx))(task); };
+        job.ctx = &fn;
+        job.tasks = tasks;
+        submit(&job);
+
+        std::unique_lock<std::mutex> lock(mu, std::defer_lock);
+        acquire(lock);
+        for (;;) {
+            if (head != &job || job.next >= job.tasks) break;
+            size_t task = claim(&job);
+            lock.unlock();
+            {
+                TraceScope span("pool task", task);
+                job.run(job.ctx, task);
+            }
+            finish(&job);
+            acquire(lock);
+        }
+        if (spin) {
+            lock.unlock();
+            while (job.done.load(std::memory_order_acquire) != job.tasks) _mm_pause();
+            return;
+        }
+        done_cv.wait(lock, [&] { return job.done.load(std::memory_order_acquire) == job.tasks; });
+    }
+
+    struct Job {
+        void (*run)(void*, size_t) = nullptr;
+        void* ctx = nullptr;
+        size_t tasks = 0;
+        void (*complete)(void*) = nullptr;  // post() only; may release the job
+        size_t next = 0;                  // guarded by mu
+        std::atomic<size_t> done{0};
+        Job* link = nullptr;              // guarded by mu
+    };
+
+    // Queues run/ctx/tasks and returns at once; complete(ctx) follows the last
+    // task. Needs at least one worker thread, and the pool must outlive the job.
+    void post(Job* job) {
+        job->next = 0;
+        job->done.store(0, std::memory_order_relaxed);
+        job->link = nullptr;
+        submit(job);
+    }
+
+private:
+    void acquire(std::unique_lock<std::mutex>& lock) {
+        if (!spin) return lock.lock();
+        while (!lock.try_lock()) _mm_pause();
+    }
+
+    void submit(Job* job) {
+        {
+            std::unique_lock<std::mutex> lock(mu, std::defer_lock);
+            acquire(lock);
+            Job** tail = &head;
+            while (*tail) tail = &(*tail)->link;
+            *tail = job;
+            queued.fetch_add(1, std::memory_order_release);
+        }
+        if (!spin) work_cv.notify_all();
+    }
+
+    // Called with mu held; dequeues the job once its last task is handed out
+    size_t claim(Job* job) {
+        size_t task = job->next++;
+        if (job->next == job->tasks) head = job->link;
+        return task;
+    }
+
+    // The job must not be touched after its last task is counted: the
+    // submitter may return and release it right away.
+    void finish(Job* job) {
+        if (job->done.fetch_add(1, std::memory_order_acq_rel) + 1 == job->tasks) {
+            if (job->complete) {
+                job->complete(job->ctx);
+                return;
+            }
+            if (spin) return;
+            { std::lock_guard<std::mutex> lock(mu); }
+            done_cv.notify_all();
+        }
+    }
+
+    void worker_loop() {
+        sqrt_trace_thread_name("pool worker");
+        std::unique_lock<std::mutex> lock(mu, std::defer_lock);
+        acquire(lock);
+        for (;;) {
+            if (spin) {
+                while (!stopping && head == nullptr) {
+                    uint64_t seen = queued.load(std::memory_order_relaxed);
+                    lock.unlock();
+                    while (queued.load(std::memory_order_acquire) == seen &&
+                           !stop_spinning.load(std::memory_order_relaxed))
+                        _mm_pause();
+                    acquire(lock);
+                }
+            } else {
+                work_cv.wait(lock, [this] { return stopping || head != nullptr; });
+            }
+            if (stopping) return;
+            Job* job = head;
+            size_t task = claim(job);
+            lock.unlock();
+            {
+                TraceScope span("pool task", task);
+                job->run(job->ctx, task);
+            }
+            finish(job);
+            acquire(lock);
+        }
+    }
+
+    const bool spin;
+    std::vector<std::thread> workers;
+    std::mutex mu;
+    std::condition_variable work_cv, done_cv;
+    Job* head = nullptr;
+    bool stopping = false;
+    std::atomic<uint64_t> queued{0};
+    std::atomic<bool> stop_spinning{false};
+};
+
+// ==================== REAL-TIME PROFILE ====================
+// realtime_enter() sets the process up so that steady-state work makes no
+// system calls and takes no page faults:
+//   - mlockall(MCL_CURRENT | MCL_FUTURE) locks what is mapped now and makes
+//     every later mapping (memo tables, service segments and rings, thread
+//     stacks) arrive populated and locked, so RLIMIT_MEMLOCK must cover them;
+//   - malloc is held to one arena that never trims and never mmaps, and the
+//     heap and stack are prefaulted, so buffers reused after init are resident;
+//   - threads pin to isolated CPUs (/sys/devices/system/cpu/isolated, else the
+//     affinity mask) and optionally run SCHED_FIFO.
+// Pass realtime_pool_options() to ThreadPool so workers pin themselves and
+// spin instead of sleeping. SCHED_FIFO stays opt-in: a spinning FIFO thread
+// on a shared CPU starves everything else there.
+//
+// rusage_during() is the self-check: it counts faults and context switches
+// across a run, which should read zero apart from involuntary switches the
+// kernel forces on CPUs that aren't isolated.
+
+struct RealtimeConfig {
+    bool lock_memory = true;
+    int fifo_priority = 0;  // 1-99 runs pinned threads SCHED_FIFO
+    std::vector<int> cpus;  // empty: isolated CPUs we may use, else all we may use
+    size_t heap_reserve = (size_t)64 << 20;
+    size_t stack_prefault = (size_t)256 << 10;
+};
+
+struct RealtimeStatus {
+    bool locked = false;
+    int fifo_priority = 0;
+    size_t stack_prefault = 0;
+    std::vector<int> cpus;
+    std::vector<std::string> warnings;
+};
+
+__attribute__((noinline)) static void prefault_stack(size_t bytes) {
+    volatile char* p = (volatile char*)alloca(bytes);
+    for (size_t i = 0; i < bytes; i += 4096) p[i] = 0;
+}
+
+// Pins the calling thread to cpus[index % size] and applies the FIFO priority
+// and stack prefault; call it first on each thread the profile should cover
+bool realtime_thread_setup(const RealtimeStatus& rt, unsigned index) {
+    bool ok = true;
+    if (!rt.cpus.empty()) {
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(rt.cpus[index % rt.cpus.size()], &one);
+        ok &= sched_setaffinity(0, sizeof(one), &one) == 0;
+    }
+    if (rt.fifo_priority > 0) {
+        sched_param param;
+        std::memset(&param, 0, sizeof(param));
+        param.sched_priority = rt.fifo_priority;
+        ok &= pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+    }
+    if (rt.stack_prefault) prefault_stack(rt.stack_prefault);
+    return ok;
+}
+
+RealtimeStatus realtime_enter(const RealtimeConfig& cfg) {
+    RealtimeStatus rt;
+    rt.fifo_priority = std::min(std::max(cfg.fifo_priority, 0), 99);
+    rt.stack_prefault = cfg.stack_prefault;
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    rt.cpus = cfg.cpus;
+    if (rt.cpus.empty()) {
+        for (int cpu : cpu_list_parse(read_sysfs("/sys/devices/system/cpu/isolated")))
+            if (CPU_ISSET(cpu, &allowed)) rt.cpus.push_back(cpu);
+        if (rt.cpus.empty()) {
+            rt.warnings.push_back("no isolated CPUs available; pinning to the affinity mask");
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+                if (CPU_ISSET(cpu, &allowed)) rt.cpus.push_back(cpu);
+        }
+    }
+
+    mallopt(M_ARENA_MAX, 1);
+    mallopt(M_MMAP_MAX, 0);
+    mallopt(M_TRIM_THRESHOLD, -1);
+    if (cfg.lock_memory) {
+        rt.locked = mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+        if (!rt.locked)
+            rt.warnings.push_back(std::string("mlockall: ") + std::strerror(errno) + " (raise RLIMIT_MEMLOCK or run with CAP_IPC_LOCK)");
+    }
+    if (cfg.heap_reserve) {
+        // With trimming off the pages stay in the heap for later allocations
+        if (char* p = (char*)std::malloc(cfg.heap_reserve)) {
+            for (size_t i = 0; i < cfg.heap_reserve; i += 4096) ((volatile char*)p)[i] = 0;
+            std::free(p);
+        }
+    }
+    if (!realtime_thread_setup(rt, 0))
+        rt.warnings.push_back(rt.fifo_priority > 0 ? "could not pin or set SCHED_FIFO (needs CAP_SYS_NICE)"
+                                                  : "could not pin to the chosen CPU");
+    return rt;
+}
+
+static void realtime_worker_start(void* ctx, unsigned worker) {
+    realtime_thread_setup(*static_cast<const RealtimeStatus*>(ctx), worker);
+}
+
+// The status must outlive the pool
+ThreadPoolOptions realtime_pool_options(const RealtimeStatus* rt) {
+    ThreadPoolOptions options;
+    options.on_start = realtime_worker_start;
+    options.ctx = const_cast<RealtimeStatus*>(rt);
+    options.spin = true;
+    return options;
+}
+
+struct RusageDelta {
+    long minor_faults = 0, major_faults = 0;
+    long voluntary_switches = 0, involuntary_switches = 0;
+
+    // Faults and voluntary switches come from the code under test;
+    // involuntary ones are the kernel preempting it
+    bool clean() const { return minor_faults == 0 && major_faults == 0 && voluntary_switches == 0; }
+};
+
+// Process-wide (all threads) fault and context-switch counts across fn()
+template<class Fn>
+RusageDelta rusage_during(Fn&& fn) {
+    rusage before, after;
+    getrusage(RUSAGE_SELF, &before);
+    fn();
+    getrusage(RUSAGE_SELF, &after);
+    RusageDelta d;
+    d.minor_faults = after.ru_minflt - before.ru_minflt;
+    d.major_faults = after.ru_majflt - before.ru_majflt;
+    d.voluntary_switches = after.ru_nvcsw - before.ru_nvcsw;
+    d.involuntary_switches = after.ru_nivcsw - before.ru_nivcsw;
+    return d;
+}
+
+// ==================== SHORTEST ROUND-TRIP FORMATTING ====================
+// Ryu (Ulf Adams, PLDI 2018): finds the shortest decimal that parses back to
+// the same double using 128-bit fixed-point powers of five, with no bignum
+// arithmetic at print time. The two power tables are generated once at
+// startup instead of being pasted in as 10 KB of constants.
+
+static const int RYU_POW5_INV_BITCOUNT = 125;
+static const int RYU_POW5_BITCOUNT = 125;
+static uint64_t ryu_pow5_inv_split[342][2];
+static uint64_t ryu_pow5_split[326][2];
+
+// ceil(log2(5^e)), floor(log10(2^e)) and floor(log10(5^e)) for the exponent range of double
+static inline int32_t ryu_pow5bits(int32_t e) { return (int32_t)(((uint32_t)e * 1217359) >> 19) + 1; }
+static inline uint32_t ryu_log10_pow2(int32_t e) { return ((uint32_t)e * 78913) >> 18; }
+static inline uint32_t ryu_log10_pow5(int32_t e) { return ((uint32_t)e * 732923) >> 20; }
+
+// Bits [shift, shift + 128) of a little-endian 32-bit limb array
+static void ryu_extract128(const std::vector<uint32_t>& limbs, int shift, uint64_t out[2]) {
+    uint32_t w[4];
+    for (int k = 0; k < 4; k++) {
+        int bit = shift + 32 * k;
+        size_t idx = (size_t)(bit / 32);
+        int off = bit % 32;
+        uint64_t lo = idx < limbs.size() ? limbs[idx] : 0;
+        uint64_t hi = idx + 1 < limbs.size() ? limbs[idx + 1] : 0;
+        w[k] = (uint32_t)(((hi << 32) | lo) >> off);
+    }
+    out[0] = ((uint64_t)w[1] << 32) | w[0];
+    out[1] = ((uint64_t)w[3] << 32) | w[2];
+}
+
+static int ryu_bitlength(const std::vector<uint32_t>& limbs) {
+    for (size_t i = limbs.size(); i-- > 0;) {
+        if (limbs[i]) return (int)(32 * i) + 32 - __builtin_clz(limbs[i]);
+    }
+    return 0;
+}
+
+static struct RyuTables {
+    RyuTables() {
+        // 5^i, truncated to its top 125 bits
+        std::vector<uint32_t> pow5(1, 1);
+        for (int i = 0; i < 326; i++) {
+            // Small powers are shifted left; prepending 4 zero limbs keeps the shift positive
+            std::vector<uint32_t> wide(4, 0);
+            wide.insert(wide.end(), pow5.begin(), pow5.end());
+            ryu_extract128(wide, 128 + ryu_bitlength(pow5) - RYU_POW5_BITCOUNT, ryu_pow5_split[i]);
+            uint64_t carry = 0;
+            for (uint32_t& limb : pow5) {
+                uint64_t p = (uint64_t)limb * 5 + carry;
+                limb = (uint32_t)p;
+                carry = p >> 32;
+            }
+            if (carry) pow5.push_back((uint32_t)carry);
+        }
+
+        // floor(2^j / 5^i) + 1 with j = pow5bits(i) - 1 + 125. Dividing the
+        // fixed-point value 2^1024 by 5 repeatedly keeps floor(2^1024 / 5^i)
+        // exact, and shifting that right gives floor(2^j / 5^i).
+        const int K = 1024;
+        std::vector<uint32_t> inv(K / 32 + 1, 0);
+        inv[K / 32] = 1;
+        for (int i = 0; i < 342; i++) {
+            int j = ryu_pow5bits(i) - 1 + RYU_POW5_INV_BITCOUNT;
+            ryu_extract128(inv, K - j, ryu_pow5_inv_split[i]);
+            if (++ryu_pow5_inv_split[i][0] == 0) ryu_pow5_inv_split[i][1]++;
+            uint64_t rem = 0;
+            for (size_t k = inv.size(); k-- > 0;) {
+                uint64_t cur = (rem << 32) | inv[k];
+                inv[k] = (uint32_t)(cur / 5);
+                rem = cur % 5;
+            }
+        }
+    }
+} ryu_tables;
+
+static inline uint32_t ryu_pow5_factor(uint64_t value) {
+    uint32_t count = 0;
+    while (value % 5 == 0) { value /= 5; count++; }
+    return count;
+}
+
+static inline uint64_t ryu_mul_shift(uint64_t m, const uint64_t* mul, int32_t j) {
+    unsigned __int128 b0 = (unsigned __int128)m * mul[0];
+    unsigned __int128 b2 = (unsigned __int128)m * mul[1];
+    return (uint64_t)(((b0 >> 64) + b2) >> (j - 64));
+}
+
+static inline uint32_t ryu_decimal_length(uint64_t v) {
+    uint32_t len = 1;
+    while (v >= 10) { v /= 10; len++; }
+    return len;
+}
+
+// Shortest decimal digits and power of ten for a positive finite double
+static void ryu_d2d(uint64_t ieee_mantissa, uint32_t ieee_exponent, uint64_t* digits, int32_t* exponent) {
+    int32_t e2;
+    uint64_t m2;
+    if (ieee_exponent == 0) {
+        e2 = 1 - 1023 - 52 - 2;
+        m2 = ieee_mantissa;
+    } else {
+        e2 = (int32_t)ieee_exponent - 1023 - 52 - 2;
+        m2 = (1ULL << 52) | ieee_mantissa;
+    }
+    const bool accept_bounds = (m2 & 1) == 0;
+
+    // Step 2: the interval of decimals that round to this double
+    const uint64_t mv = 4 * m2;
+    const uint32_t mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+
+    // Step 3: convert it to a decimal power base
+    uint64_t vr, vp, vm;
+    int32_t e10;
+    bool vm_trailing_zeros = false, vr_trailing_zeros = false;
+    if (e2 >= 0) {
+        const uint32_t q = ryu_log10_pow2(e2) - (e2 > 3);
+        e10 = (int32_t)q;
+        const int32_t k = RYU_POW5_INV_BITCOUNT + ryu_pow5bits((int32_t)q) - 1;
+        const int32_t i = -e2 + (int32_t)q + k;
+        vr = ryu_mul_shift(4 * m2, ryu_pow5_inv_split[q], i);
+        vp = ryu_mul_shift(4 * m2 + 2, ryu_pow5_inv_split[q], i);
+        vm = ryu_mul_shift(4 * m2 - 1 - mm_shift, ryu_pow5_inv_split[q], i);
+        if (q <= 21) {
+            if (mv % 5 == 0) {
+                vr_trailing_zeros = ryu_pow5_factor(mv) >= q;
+            } else if (accept_bounds) {
+                vm_trailing_zeros = ryu_pow5_factor(mv - 1 - mm_shift) >= q;
+            } else {
+                vp -= ryu_pow5_factor(mv + 2) >= q;
+            }
+        }
+    } else {
+        const uint32_t q = ryu_log10_pow5(-e2) - (-e2 > 1);
+        e10 = (int32_t)q + e2;
+        const int32_t i = -e2 - (int32_t)q;
+        const int32_t k = ryu_pow5bits(i) - RYU_POW5_BITCOUNT;
+        const int32_t j = (int32_t)q - k;
+        vr = ryu_mul_shift(4 * m2, ryu_pow5_split[i], j);
+        vp = ryu_mul_shift(4 * m2 + 2, ryu_pow5_split[i], j);
+        vm = ryu_mul_shift(4 * m2 - 1 - mm_shift, ryu_pow5_split[i], j);
+        if (q <= 1) {
+            vr_trailing_zeros = true;
+            if (accept_bounds) vm_trailing_zeros = mm_shift == 1;
+            else --vp;
+        } else if (q < 63) {
+            vr_trailing_zeros = (mv & ((1ULL << q) - 1)) == 0;
+        }
+    }
+
+    // Step 4: drop digits while the interval still holds a shorter decimal
+    int32_t removed = 0;
+    uint8_t last_removed_digit = 0;
+    uint64_t output;
+    if (vm_trailing_zeros || vr_trailing_zeros) {
+        while (vp / 10 > vm / 10) {
+            vm_trailing_zeros &= vm % 10 == 0;
+            vr_trailing_zeros &= last_removed_digit == 0;
+            last_removed_digit = (uint8_t)(vr % 10);
+            vr /= 10; vp /= 10; vm /= 10;
+            removed++;
+        }
+        if (vm_trailing_zeros) {
+            while (vm % 10 == 0) {
+                vr_trailing_zeros &= last_removed_digit == 0;
+                last_removed_digit = (uint8_t)(vr % 10);
+                vr /= 10; vp /= 10; vm /= 10;
+                removed++;
+            }
+        }
+        if (vr_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0) {
+            last_removed_digit = 4;  // exactly halfway: round to even
+        }
+        output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed_digit >= 5);
+    } else {
+        bool round_up = false;
+        while (vp / 10 > vm / 10) {
+            round_up = vr % 10 >= 5;
+            vr /= 10; vp /= 10; vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || round_up);
+    }
+    *digits = output;
+    *exponent = e10 + removed;
+}
+
+// Writes the shortest round-trip representation of x to buf (at least 32
+// bytes) and returns the number of characters. Uses plain notation for
+// exponents in [-5, 16], scientific otherwise.
+size_t format_shortest(double x, char* buf) {
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    const bool sign = bits >> 63;
+    const uint64_t ieee_mantissa = bits & ((1ULL << 52) - 1);
+    const uint32_t ieee_exponent = (uint32_t)((bits >> 52) & 0x7ff);
+
+    char* p = buf;
+    if (ieee_exponent == 0x7ff) {
+        if (ieee_mantissa) { std::memcpy(p, "nan", 3); return 3; }
+        if (sign) *p++ = '-';
+        std::memcpy(p, "inf", 3);
+        return (size_t)(p - buf) + 3;
+    }
+    if (sign) *p++ = '-';
+    if (ieee_exponent == 0 && ieee_mantissa == 0) {
+        *p++ = '0';
+        return (size_t)(p - buf);
+    }
+
+    uint64_t digits;
+    int32_t e10;
+    ryu_d2d(ieee_mantissa, ieee_exponent, &digits, &e10);
+    const int32_t len = (int32_t)ryu_decimal_length(digits);
+    const int32_t sci = e10 + len - 1;
+
+    char d[17] = {};
+    for (int32_t i = len - 1; i >= 0; i--) { d[i] = (char)('0' + digits % 10); digits /= 10; }
+
+    if (sci >= -5 && sci <= 16) {
+        if (e10 >= 0) {
+            std::memcpy(p, d, (size_t)len); p += len;
+            for (int32_t i = 0; i < e10; i++) *p++ = '0';
+        } else if (sci >= 0) {
+            std::memcpy(p, d, (size_t)(sci + 1)); p += sci + 1;
+            *p++ = '.';
+            std::memcpy(p, d + sci + 1, (size_t)(len - sci - 1)); p += len - sci - 1;
+        } else {
+            *p++ = '0'; *p++ = '.';
+            for (int32_t i = 0; i < -sci - 1; i++) *p++ = '0';
+            std::memcpy(p, d, (size_t)len); p += len;
+        }
+    } else {
+        *p++ = d[0];
+        if (len > 1) {
+            *p++ = '.';
+            std::memcpy(p, d + 1, (size_t)(len - 1)); p += len - 1;
+        }
+        *p++ = 'e';
+        int32_t e = sci;
+        if (e < 0) { *p++ = '-'; e = -e; } else { *p++ = '+'; }
+        if (e >= 100) { *p++ = (char)('0' + e / 100); e %= 100; }
+        *p++ = (char)('0' + e / 10);
+        *p++ = (char)('0' + e % 10);
+    }
+    return (size_t)(p - buf);
+}
+
+// ==================== STREAMING FILTER ====================
+// sqrt filter: numbers in, square roots out, for multi-GB text exports.
+// Input is read in large blocks with read(2); each block is cut at separator
+// boundaries into one piece per thread, and every piece is parsed with
+// std::from_chars, rooted with sqrt_batch and formatted with Ryu into its own
+// output buffer. Pieces are written back in order, so output lines up with
+// input: each number is followed by '\n' if the run of separators after it
+// holds a line break (or reaches the end of the input), ',' otherwise. Blocks
+// and pieces are cut only where a token starts, so no run is split.
+
+static inline bool is_separator(char c) {
+    return c == ',' || c == '\n' || c == '\r' || c == ' ' || c == '\t';
+}
+
+struct FilterPiece {
+    const char* begin;
+    const char* end;
+    std::vector<double> values;
+    std::vector<char> seps;
+    std::vector<char> out;
+    const char* error = nullptr;  // first token that failed to parse
+    bool final = false;           // ends at the end of the input
+};
+
+static void filter_piece(FilterPiece& piece, SqrtTier tier) {
+    piece.values.clear();
+    piece.seps.clear();
+    const char* p = piece.begin;
+    {
+        TraceScope span("filter parse", (uint64_t)(piece.end - piece.begin));
+        while (p < piece.end) {
+            if (is_separator(*p)) { p++; continue; }
+            const char* start = p;
+            if (*p == '+') p++;
+            double value;
+            std::from_chars_result r = std::from_chars(p, piece.end, value);
+            if (r.ec != std::errc() || (r.ptr < piece.end && !is_separator(*r.ptr))) {
+                piece.error = start;
+                return;
+            }
+            p = r.ptr;
+            piece.values.push_back(value);
+            bool line_break = false;
+            for (; p < piece.end && is_separator(*p); p++) line_break |= *p == '\n' || *p == '\r';
+            piece.seps.push_back(line_break || (p == piece.end && piece.final) ? '\n' : ',');
+        }
+    }
+
+    sqrt_batch(piece.values.data(), piece.values.data(), piece.values.size(), tier);
+
+    TraceScope span("filter format", piece.values.size());
+    piece.out.resize(piece.values.size() * 25);
+    char* o = piece.out.data();
+    for (size_t i = 0; i < piece.values.size(); i++) {
+        o += format_shortest(piece.values[i], o);
+        *o++ = piece.seps[i];
+    }
+    piece.out.resize((size_t)(o - piece.out.data()));
+}
+
+static bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t w = write(fd, data, size);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += w;
+        size -= (size_t)w;
+    }
+    return true;
+}
+
+int run_filter(int argc, char** argv) {
+    const char* input = nullptr;
+    const char* output = nullptr;
+    unsigned threads = 1;
+    size_t block_size = 16u << 20;
+    SqrtTier tier = SQRT_EXACT;
+    for (int i = 0; i < argc; i++) {
+        if (!std::strcmp(argv[i], "-j") && i + 1 < argc) {
+            threads = (unsigned)std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "-o") && i + 1 < argc) {
+            output = argv[++i];
+        } else if (!std::strcmp(argv[i], "-b") && i + 1 < argc) {
+            block_size = (size_t)std::max(1, std::atoi(argv[++i])) << 20;
+        } else if (!std::strcmp(argv[i], "-m") && i + 1 < argc) {
+            if (!parse_tier(argv[++i], &tier)) {
+                std::cerr << "unknown method: " << argv[i] << "\n";
+                return 2;
+            }
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            std::cerr << "usage: sqrt filter [-j threads] [-b block_MiB] [-m exact|optimal|fast] [-o out] [file]\n";
+            return 2;
+        } else {
+            input = argv[i];
+        }
+    }
+
+    int in_fd = 0, out_fd = 1;
+    if (input && std::strcmp(input, "-") != 0) {
+        in_fd = open(input, O_RDONLY);
+        if (in_fd < 0) { std::perror(input); return 1; }
+        posix_fadvise(in_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    if (output) {
+        out_fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out_fd < 0) { std::perror(output); return 1; }
+    }
+
+    ThreadPool pool(threads);
+    std::vector<FilterPiece> pieces(threads);
+    std::vector<char> buf(block_size + 1);
+    size_t carry = 0;      // bytes of an unfinished token kept from the last block
+    uint64_t consumed = 0; // input offset of buf[0], for error messages
+    bool eof = false;
+    int status = 0;
+
+    while (!eof) {
+        size_t filled = carry;
+        {
+            TraceScope span("filter read");
+            while (filled < buf.size()) {
+                ssize_t r = read(in_fd, buf.data() + filled, buf.size() - filled);
+                if (r < 0 && errno == EINTR) continue;
+                if (r < 0) { std::perror("read"); return 1; }
+                if (r == 0) { eof = true; break; }
+                filled += (size_t)r;
+            }
+        }
+
+        // Process up to the start of the last token and keep it for later: it
+        // may be partial, and the separators after it may continue
+        size_t usable = filled;
+        if (!eof) {
+            while (usable > 0 && is_separator(buf[usable - 1])) usable--;
+            while (usable > 0 && !is_separator(buf[usable - 1])) usable--;
+            if (usable == 0) {
+                if (filled == buf.size()) buf.resize(buf.size() * 2);  // token longer than a block
+                carry = filled;
+                continue;
+            }
+        }
+
+        // One piece per thread, each ending where a token starts
+        const char* base = buf.data();
+        size_t start = 0;
+        for (unsigned t = 0; t < threads; t++) {
+            size_t end = t + 1 == threads ? usable : std::max(start, usable * (t + 1) / threads);
+            while (end > 0 && end < usable && (!is_separator(base[end - 1]) || is_separator(base[end]))) end++;
+            pieces[t].begin = base + start;
+            pieces[t].end = base + end;
+            pieces[t].error = nullptr;
+            pieces[t].final = eof && end == usable;
+            start = end;
+        }
+
+        pool.parallel_for(threads, [&](size_t t) { filter_piece(pieces[t], tier); });
+
+        for (FilterPiece& piece : pieces) {
+            if (piece.error) {
+                const char* e = piece.error;
+                const char* stop = e;
+                while (stop < piece.end && !is_separator(*stop) && stop - e < 40) stop++;
+                std::cerr << "sqrt filter: bad number at byte " << consumed + (uint64_t)(e - base)
+                          << ": \"" << std::string(e, stop) << "\"\n";
+                status = 1;
+                eof = true;
+                break;
+            }
+            TraceScope span("filter write", piece.out.size());
+            if (!write_all(out_fd, piece.out.data(), piece.out.size())) {
+                std::perror("write");
+                return 1;
+            }
+        }
+
+        carry = filled - usable;
+        std::memmove(buf.data(), buf.data() + usable, carry);
+        consumed += usable;
+    }
+
+    if (in_fd != 0) close(in_fd);
+    if (out_fd != 1 && close(out_fd) != 0) { std::perror("close"); return 1; }
+    return status;
+}
+
+// ==================== MEMORY-MAPPED TRANSFORM ====================
+// sqrt mmap: raw little-endian float32/float64 file in, same-size file of
+// roots out, with no read()/write() copies. The file is mapped one window at
+// a time (MAP_POPULATE + MADV_SEQUENTIAL), so files larger than RAM never try
+// to populate at once. Each window is split into page-aligned chunks that the
+// pool runs through sqrt_batch.
+
+template <class T>
+static void mmap_window(const T* in, T* out, size_t n, ThreadPool& pool, SqrtTier tier) {
+    const size_t page_elems = 4096 / sizeof(T);
+    size_t chunks = (size_t)pool.size() * 4;
+    size_t chunk = (n + chunks - 1) / chunks;
+    chunk = std::max(page_elems, (chunk + page_elems - 1) / page_elems * page_elems);
+    chunks = (n + chunk - 1) / chunk;
+    pool.parallel_for(chunks, [&](size_t c) {
+        size_t begin = c * chunk;
+        sqrt_batch(in + begin, out + begin, std::min(chunk, n - begin), tier);
+    });
+}
+
+static void* map_range(int fd, size_t offset, size_t size, bool writable) {
+    TraceScope span("mmap populate", size);
+    int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* p = mmap(nullptr, size, prot, MAP_SHARED | MAP_POPULATE, fd, (off_t)offset);
+    if (p == MAP_FAILED) return nullptr;
+    madvise(p, size, MADV_SEQUENTIAL);
+    return p;
+}
+
+// True when path names the file already open as fd, which O_TRUNC would wipe
+static bool same_file(int fd, const char* path) {
+    struct stat a, b;
+    return fstat(fd, &a) == 0 && stat(path, &b) == 0 && a.st_dev == b.st_dev && a.st_ino == b.st_ino;
+}
+
+int run_mmap(int argc, char** argv) {
+    const char* paths[2] = {nullptr, nullptr};
+    int npaths = 0;
+    bool in_place = false, use_f32 = false;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t window = (size_t)1 << 30;
+    SqrtTier tier = SQRT_EXACT;
+    for (int i = 0; i < argc; i++) {
+        if (!std::strcmp(argv[i], "-t") && i + 1 < argc) {
+            i++;
+            if (!std::strcmp(argv[i], "f32")) use_f32 = true;
+            else if (!std::strcmp(argv[i], "f64")) use_f32 = false;
+            else { std::cerr << "unknown type: " << argv[i] << "\n"; return 2; }
+        } else if (!std::strcmp(argv[i], "-j") && i + 1 < argc) {
+            threads = (unsigned)std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "-w") && i + 1 < argc) {
+            window = (size_t)std::max(1, std::atoi(argv[++i])) << 20;
+        } else if (!std::strcmp(argv[i], "-m") && i + 1 < argc) {
+            if (!parse_tier(argv[++i], &tier)) { std::cerr << "unknown method: " << argv[i] << "\n"; return 2; }
+        } else if (!std::strcmp(argv[i], "--in-place")) {
+            in_place = true;
+        } else if (argv[i][0] != '-' && npaths < 2) {
+            paths[npaths++] = argv[i];
+        } else {
+            npaths = -1;
+            break;
+        }
+    }
+    if (npaths != (in_place ? 1 : 2)) {
+        std::cerr << "usage: sqrt mmap [-t f32|f64] [-j threads] [-w window_MiB] [-m exact|optimal|fast] in out\n"
+                  << "       sqrt mmap [-t f32|f64] ... --in-place file\n";
+        return 2;
+    }
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+    std::cerr << "sqrt mmap: raw files are little-endian; this host is not\n";
+    return 1;
+#endif
+
+    const size_t elem = use_f32 ? sizeof(float) : sizeof(double);
+    int in_fd = open(paths[0], in_place ? O_RDWR : O_RDONLY);
+    if (in_fd < 0) { std::perror(paths[0]); return 1; }
+    struct stat st;
+    if (fstat(in_fd, &st) != 0) { std::perror(paths[0]); return 1; }
+    const size_t size = (size_t)st.st_size;
+    if (size % elem != 0) {
+        std::cerr << "sqrt mmap: " << paths[0] << " is " << size << " bytes, not a multiple of " << elem << "\n";
+        return 1;
+    }
+
+    int out_fd = in_fd;
+    if (!in_place) {
+        if (same_file(in_fd, paths[1])) {
+            std::cerr << "sqrt mmap: " << paths[1] << " is the input file; use --in-place\n";
+            return 1;
+        }
+        out_fd = open(paths[1], O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (out_fd < 0) { std::perror(paths[1]); return 1; }
+        // Reserve the blocks up front: a sparse file that hits ENOSPC mid-run
+        // would surface as SIGBUS on a mapped store instead of an error here
+        if (size > 0) {
+            int err = posix_fallocate(out_fd, 0, (off_t)size);
+            if (err != 0) {
+                std::cerr << "sqrt mmap: " << paths[1] << ": " << std::strerror(err) << "\n";
+                return 1;
+            }
+        }
+    }
+
+    ThreadPool pool(threads);
+    window = std::max<size_t>(window / 4096 * 4096, 4096);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t offset = 0; offset < size; offset += window) {
+        size_t len = std::min(window, size - offset);
+        void* in = map_range(in_fd, offset, len, in_place);
+        void* out = in_place ? in : map_range(out_fd, offset, len, true);
+        if (!in || !out) { std::perror("mmap"); return 1; }
+        if (use_f32) mmap_window((const float*)in, (float*)out, len / elem, pool, tier);
+        else mmap_window((const double*)in, (double*)out, len / elem, pool, tier);
+        munmap(in, len);
+        if (!in_place) munmap(out, len);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double secs = std::chrono::duration<double>(end - start).count();
+
+    close(in_fd);
+    if (!in_place && close(out_fd) != 0) { std::perror("close"); return 1; }
+    std::cerr << "sqrt mmap: " << size / elem << " elements in " << std::fixed << std::setprecision(3)
+              << secs << " s (" << std::setprecision(2) << (double)size / secs / 1e9 << " GB/s)\n";
+    return 0;
+}
+
+// ==================== IO_URING STREAMING ====================
+// sqrt uring: out-of-core version of sqrt mmap for files bigger than RAM or
+// on slow storage. N aligned O_DIRECT buffers stay in flight; when a read
+// completes its buffer is rooted in place and written back asynchronously,
+// then reused for the next read. Talks to the kernel with the raw io_uring
+// syscalls and ring mappings, so liburing is not needed.
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+
+class Uring {
+public:
+    ~Uring() {
+        if (sqes) munmap(sqes, sqes_size);
+        if (cq_ptr && cq_ptr != sq_ptr) munmap(cq_ptr, cq_size);
+        if (sq_ptr) munmap(sq_ptr, sq_size);
+        if (fd >= 0) close(fd);
+    }
+
+    bool init(unsigned entries) {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+        if (fd < 0) return false;
+
+        sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        if (p.features & IORING_FEAT_SINGLE_MMAP) sq_size = cq_size = std::max(sq_size, cq_size);
+        sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED) { sq_ptr = nullptr; return false; }
+        if (p.features & IORING_FEAT_SINGLE_MMAP) {
+            cq_ptr = sq_ptr;
+        } else {
+            cq_ptr = mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cq_ptr == MAP_FAILED) { cq_ptr = nullptr; return false; }
+        }
+        sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+        sqes = (io_uring_sqe*)mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) { sqes = nullptr; return false; }
+
+        char* sq = (char*)sq_ptr;
+        sq_tail = (unsigned*)(sq + p.sq_off.tail);
+        sq_mask = *(unsigned*)(sq + p.sq_off.ring_mask);
+        sq_array = (unsigned*)(sq + p.sq_off.array);
+        char* cq = (char*)cq_ptr;
+        cq_head = (unsigned*)(cq + p.cq_off.head);
+        cq_tail = (unsigned*)(cq + p.cq_off.tail);
+        cq_mask = *(unsigned*)(cq + p.cq_off.ring_mask);
+        cqes = (io_uring_cqe*)(cq + p.cq_off.cqes);
+        return true;
+    }
+
+    // Queues one read or write; it is handed to the kernel by the next enter()
+    void queue(uint8_t opcode, int file, void* buf, unsigned len, uint64_t offset, uint64_t user_data) {
+        unsigned tail = *sq_tail;
+        unsigned idx = tail & sq_mask;
+        io_uring_sqe* sqe = &sqes[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->fd = file;
+        sqe->addr = (uint64_t)(uintptr_t)buf;
+        sqe->len = len;
+        sqe->off = offset;
+        sqe->user_data = user_data;
+        sq_array[idx] = idx;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        pending++;
+    }
+
+    // Submits queued entries and waits for at least wait_nr completions
+    int enter(unsigned wait_nr) {
+        unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+        int r = (int)syscall(__NR_io_uring_enter, fd, pending, wait_nr, flags, nullptr, 0);
+        if (r >= 0) pending -= (unsigned)r;
+        return r;
+    }
+
+    bool peek(io_uring_cqe* out) {
+        unsigned head = *cq_head;
+        if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) return false;
+        *out = cqes[head & cq_mask];
+        __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+private:
+    int fd = -1;
+    void* sq_ptr = nullptr;
+    void* cq_ptr = nullptr;
+    size_t sq_size = 0, cq_size = 0, sqes_size = 0;
+    io_uring_sqe* sqes = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned sq_mask = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned pending = 0;
+};
+
+// Opens with O_DIRECT, falling back to the page cache on filesystems that refuse it
+static int open_direct(const char* path, int flags, bool* direct) {
+    int fd = open(path, flags | O_DIRECT, 0644);
+    *direct = fd >= 0;
+    if (fd < 0 && errno == EINVAL) fd = open(path, flags, 0644);
+    return fd;
+}
+#endif
+
+int run_uring(int argc, char** argv) {
+#if defined(HAVE_IO_URING)
+    const char* paths[2] = {nullptr, nullptr};
+    int npaths = 0;
+    bool use_f32 = false;
+    unsigned depth = 4;
+    size_t buf_size = (size_t)4 << 20;
+    SqrtTier tier = SQRT_EXACT;
+    for (int i = 0; i < argc; i++) {
+        if (!std::strcmp(argv[i], "-t") && i + 1 < argc) {
+            i++;
+            if (!std::strcmp(argv[i], "f32")) use_f32 = true;
+            else if (!std::strcmp(argv[i], "f64")) use_f32 = false;
+            else { std::cerr << "unknown type: " << argv[i] << "\n"; return 2; }
+        } else if (!std::strcmp(argv[i], "-q") && i + 1 < argc) {
+            depth = (unsigned)std::max(2, std::min(256, std::atoi(argv[++i])));
+        } else if (!std::strcmp(argv[i], "-b") && i + 1 < argc) {
+            buf_size = (size_t)std::max(1, std::atoi(argv[++i])) << 20;
+        } else if (!std::strcmp(argv[i], "-m") && i + 1 < argc) {
+            if (!parse_tier(argv[++i], &tier)) { std::cerr << "unknown method: " << argv[i] << "\n"; return 2; }
+        } else if (argv[i][0] != '-' && npaths < 2) {
+            paths[npaths++] = argv[i];
+        } else {
+            npaths = -1;
+            break;
+        }
+    }
+    if (npaths != 2) {
+        std::cerr << "usage: sqrt uring [-t f32|f64] [-q buffers] [-b buffer_MiB] [-m exact|optimal|fast] in out\n";
+        return 2;
+    }
+
+    const size_t elem = use_f32 ? sizeof(float) : sizeof(double);
+    const size_t align = 4096;
+    bool in_direct, out_direct;
+    int in_fd = open_direct(paths[0], O_RDONLY, &in_direct);
+    if (in_fd < 0) { std::perror(paths[0]); return 1; }
+    struct stat st;
+    if (fstat(in_fd, &st) != 0) { std::perror(paths[0]); return 1; }
+    const uint64_t size = (uint64_t)st.st_size;
+    if (size % elem != 0) {
+        std::cerr << "sqrt uring: " << paths[0] << " is " << size << " bytes, not a multiple of " << elem << "\n";
+        return 1;
+    }
+    if (same_file(in_fd, paths[1])) {
+        std::cerr << "sqrt uring: " << paths[1] << " is the input file\n";
+        return 1;
+    }
+    int out_fd = open_direct(paths[1], O_WRONLY | O_CREAT | O_TRUNC, &out_direct);
+    if (out_fd < 0) { std::perror(paths[1]); return 1; }
+
+    Uring ring;
+    if (!ring.init(depth * 2)) { std::perror("io_uring_setup"); return 1; }
+
+    struct Buffer {
+        char* data = nullptr;
+        uint64_t offset = 0;
+        size_t filled = 0;  // bytes read so far for this block
+        size_t want = 0;    // bytes of file data in this block
+        size_t written = 0; // bytes written so far for this block
+        size_t write_len = 0;  // want, padded to the block size for O_DIRECT
+    };
+    std::vector<Buffer> bufs(depth);
+    for (Buffer& b : bufs) {
+        if (posix_memalign((void**)&b.data, align, buf_size) != 0) { std::cerr << "out of memory\n"; return 1; }
+    }
+
+    const uint64_t WRITE_FLAG = 1ULL << 32;
+    uint64_t next_offset = 0;
+    unsigned in_flight = 0;
+    auto issue_read = [&](unsigned b) {
+        Buffer& buf = bufs[b];
+        buf.offset = next_offset;
+        buf.want = (size_t)std::min<uint64_t>(buf_size, size - next_offset);
+        buf.filled = 0;
+        next_offset += buf.want;
+        size_t len = in_direct ? (buf.want + align - 1) / align * align : buf.want;
+        ring.queue(IORING_OP_READ, in_fd, buf.data, (unsigned)len, buf.offset, b);
+        in_flight++;
+    };
+    for (unsigned b = 0; b < depth && next_offset < size; b++) issue_read(b);
+
+    typedef std::chrono::steady_clock clock;
+    double compute_secs = 0, overlapped_secs = 0, stall_secs = 0;
+    uint64_t bytes_done = 0;
+    auto start = clock::now();
+    while (in_flight > 0) {
+        io_uring_cqe cqe;
+        if (!ring.peek(&cqe)) {
+            auto t0 = clock::now();
+            int r;
+            {
+                TraceScope span("uring wait", in_flight);
+                r = ring.enter(1);
+            }
+            stall_secs += std::chrono::duration<double>(clock::now() - t0).count();
+            if (r < 0 && errno != EINTR) { std::perror("io_uring_enter"); return 1; }
+            continue;
+        }
+        in_flight--;
+        unsigned b = (unsigned)(cqe.user_data & 0xffffffffu);
+        Buffer& buf = bufs[b];
+        if (cqe.res < 0) {
+            errno = -cqe.res;
+            std::perror(cqe.user_data & WRITE_FLAG ? "write" : "read");
+            return 1;
+        }
+
+        // A short transfer resumes where it stopped. O_DIRECT needs an aligned
+        // offset and length, so there it backs up to the last block boundary
+        // and redoes the overlap; a transfer that didn't cross one is an error.
+        if (cqe.user_data & WRITE_FLAG) {
+            const size_t start = buf.written;
+            buf.written += (size_t)cqe.res;
+            if (buf.written < buf.write_len) {
+                const size_t from = out_direct ? buf.written / align * align : buf.written;
+                if (from == start) { std::cerr << "sqrt uring: write made no progress\n"; return 1; }
+                buf.written = from;
+                ring.queue(IORING_OP_WRITE, out_fd, buf.data + from, (unsigned)(buf.write_len - from),
+                           buf.offset + from, WRITE_FLAG | b);
+                in_flight++;
+            } else {
+                bytes_done += buf.want;
+                if (next_offset < size) issue_read(b);
+            }
+        } else {
+            const size_t start = buf.filled;
+            buf.filled += (size_t)cqe.res;
+            if (buf.filled < buf.want) {
+                if (cqe.res == 0) { std::cerr << "sqrt uring: unexpected end of file\n"; return 1; }
+                const size_t from = in_direct ? buf.filled / align * align : buf.filled;
+                if (from == start) { std::cerr << "sqrt uring: read made no aligned progress\n"; return 1; }
+                const size_t end = in_direct ? (buf.want + align - 1) / align * align : buf.want;
+                buf.filled = from;
+                ring.queue(IORING_OP_READ, in_fd, buf.data + from, (unsigned)(end - from), buf.offset + from, b);
+                in_flight++;
+            } else {
+                // Other buffers' reads and writes proceed while this one computes
+                auto t0 = clock::now();
+                if (use_f32) sqrt_batch((const float*)buf.data, (float*)buf.data, buf.want / elem, tier);
+                else sqrt_batch((const double*)buf.data, (double*)buf.data, buf.want / elem, tier);
+                double secs = std::chrono::duration<double>(clock::now() - t0).count();
+                compute_secs += secs;
+                if (in_flight > 0) overlapped_secs += secs;
+
+                buf.written = 0;
+                buf.write_len = out_direct ? (buf.want + align - 1) / align * align : buf.want;
+                ring.queue(IORING_OP_WRITE, out_fd, buf.data, (unsigned)buf.write_len, buf.offset, WRITE_FLAG | b);
+                in_flight++;
+            }
+        }
+        if (ring.enter(0) < 0 && errno != EINTR) { std::perror("io_uring_enter"); return 1; }
+    }
+    double wall = std::chrono::duration<double>(clock::now() - start).count();
+
+    // O_DIRECT writes are padded to the block size
+    if (ftruncate(out_fd, (off_t)size) != 0) { std::perror(paths[1]); return 1; }
+    for (Buffer& b : bufs) free(b.data);
+    close(in_fd);
+    if (close(out_fd) != 0) { std::perror("close"); return 1; }
+
+    std::cerr << std::fixed << std::setprecision(3)
+              << "sqrt uring: " << bytes_done / elem << " elements, " << depth << " x "
+              << (buf_size >> 20) << " MiB buffers, O_DIRECT " << (in_direct ? "in" : "-") << "/"
+              << (out_direct ? "out" : "-") << "\n"
+              << "  wall     " << wall << " s (" << std::setprecision(2) << (double)size / wall / 1e9 << " GB/s)\n"
+              << std::setprecision(3)
+              << "  compute  " << compute_secs << " s, " << std::setprecision(1)
+              << (compute_secs > 0 ? 100.0 * overlapped_secs / compute_secs : 0.0) << "% with I/O in flight\n"
+              << std::setprecision(3)
+              << "  I/O wait " << stall_secs << " s (" << std::setprecision(1)
+              << (wall > 0 ? 100.0 * stall_secs / wall : 0.0) << "% of wall: "
+              << (stall_secs > compute_secs ? "I/O bound" : "compute bound") << ")\n";
+    return 0;
+#else
+    (void)argc;
+    (void)argv;
+    std::cerr << "sqrt uring: built without <linux/io_uring.h>\n";
+    return 1;
+#endif
+}
+
+// ==================== BLOCK CONTAINER FORMAT ====================
+// .sqb: a simple chunked container for sqrt inputs and outputs. A 64-byte
+// file header is followed by fixed-size blocks, each a 64-byte header plus
+// block_elems values (the last block is zero-padded), so block k sits at a
+// computable offset and can be skipped or processed on its own. Block headers
+// hold the element count, type, exponent range, special-value flags and a
+// CRC32C of the payload. All fields are little-endian.
+//
+// sqrt sqb root uses the headers to:
+//   - pick sqrt_batch_normal for clean blocks (no negatives, zeros,
+//     subnormals, inf or NaN), skipping special-value handling entirely;
+//   - skip blocks whose output already records the checksum of the input
+//     block it came from, so rerunning after a partial change only
+//     recomputes the blocks that changed (skipped blocks are not read, so
+//     only recomputed blocks have their input checksum verified);
+//   - process blocks in parallel on the thread pool.
+
+enum SqbType : uint32_t { SQB_F32 = 1, SQB_F64 = 2 };
+
+enum SqbFlags : uint32_t {
+    SQB_HAS_NEGATIVE  = 1,
+    SQB_HAS_ZERO      = 2,
+    SQB_HAS_SUBNORMAL = 4,
+    SQB_HAS_NONFINITE = 8   // inf or NaN
+};
+
+struct SqbFileHeader {
+    char magic[8];            // "HPCSQB1"
+    uint32_t version;
+    uint32_t type;            // SqbType
+    uint32_t block_elems;
+    uint32_t reserved;
+    uint64_t total_elems;
+    uint64_t block_count;
+    uint8_t pad[24];
+};
+
+struct SqbBlockHeader {
+    uint32_t count;           // valid elements in this block
+    uint32_t type;            // SqbType
+    int32_t min_exp;          // unbiased binary exponent range of the
+    int32_t max_exp;          //   positive normal values (0, 0 if none)
+    uint32_t flags;           // SqbFlags
+    uint32_t checksum;        // CRC32C of the count valid values
+    uint32_t source_checksum; // outputs: checksum of the input block
+    uint32_t tier;            // outputs: SqrtTier + 1; inputs: 0
+    uint8_t pad[32];
+};
+
+static_assert(sizeof(SqbFileHeader) == 64, "sqb file header is 64 bytes");
+static_assert(sizeof(SqbBlockHeader) == 64, "sqb block header is 64 bytes");
+
+static const char SQB_MAGIC[8] = {'H', 'P', 'C', 'S', 'Q', 'B', '1', '\0'};
+
+uint32_t crc32c(const void* data, size_t size) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint32_t crc = 0xffffffffu;
+#if defined(__SSE4_2__)
+    uint64_t crc64 = crc;
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        crc64 = _mm_crc32_u64(crc64, v);
+    }
+    crc = (uint32_t)crc64;
+    for (; size > 0; p++, size--) crc = _mm_crc32_u8(crc, *p);
+#else
+    for (; size > 0; p++, size--) {
+        crc ^= *p;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0x82f63b78u & (0u - (crc & 1)));
+    }
+#endif
+    return ~crc;
+}
+
+template <class T> struct FloatBits;
+template <> struct FloatBits<float> {
+    typedef uint32_t U;
+    static const int MANT = 23, BIAS = 127, EXP_MAX = 0xff;
+};
+template <> struct FloatBits<double> {
+    typedef uint64_t U;
+    static const int MANT = 52, BIAS = 1023, EXP_MAX = 0x7ff;
+};
+
+// Fills in count, exponent range, flags and checksum for a block payload
+template <class T>
+static void sqb_describe(const T* values, uint32_t count, SqbBlockHeader* h) {
+    typedef FloatBits<T> FB;
+    int min_exp = INT32_MAX, max_exp = INT32_MIN;
+    uint32_t flags = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        typename FB::U bits;
+        std::memcpy(&bits, &values[i], sizeof(bits));
+        int biased = (int)((bits >> FB::MANT) & FB::EXP_MAX);
+        bool negative = bits >> (sizeof(bits) * 8 - 1);
+        bool mant_zero = (bits & (((typename FB::U)1 << FB::MANT) - 1)) == 0;
+        if (biased == FB::EXP_MAX) { flags |= SQB_HAS_NONFINITE; continue; }
+        if (biased == 0) { flags |= mant_zero ? SQB_HAS_ZERO : SQB_HAS_SUBNORMAL; }
+        if (negative && !(biased == 0 && mant_zero)) { flags |= SQB_HAS_NEGATIVE; continue; }
+        if (biased == 0) continue;
+        min_exp = std::min(min_exp, biased - FB::BIAS);
+        max_exp = std::max(max_exp, biased - FB::BIAS);
+    }
+    h->count = count;
+    h->type = sizeof(T) == 4 ? SQB_F32 : SQB_F64;
+    h->min_exp = min_exp <= max_exp ? min_exp : 0;
+    h->max_exp = min_exp <= max_exp ? max_exp : 0;
+    h->flags = flags;
+    h->checksum = crc32c(values, count * sizeof(T));
+}
+
+// Clean blocks can take the kernel without special-case handling
+static bool sqb_clean(const SqbBlockHeader& h, SqrtTier tier) {
+    if (h.flags & (SQB_HAS_NEGATIVE | SQB_HAS_ZERO | SQB_HAS_SUBNORMAL | SQB_HAS_NONFINITE)) return false;
+    // The fast tier's rsqrt estimate only covers the float range. Exponent 127
+    // also holds doubles above FLT_MAX, which narrow to inf, so it is excluded.
+    return tier != SQRT_FAST || (h.min_exp >= -126 && h.max_exp <= 126);
+}
+
+// A mapped .sqb file
+struct SqbFile {
+    int fd = -1;
+    char* base = nullptr;
+    size_t size = 0;
+
+    ~SqbFile() {
+        if (base) munmap(base, size);
+        if (fd >= 0) close(fd);
+    }
+    SqbFileHeader* header() const { return (SqbFileHeader*)base; }
+    size_t elem_size() const { return header()->type == SQB_F32 ? 4 : 8; }
+    size_t block_bytes() const { return sizeof(SqbBlockHeader) + header()->block_elems * elem_size(); }
+    SqbBlockHeader* block(uint64_t k) const {
+        return (SqbBlockHeader*)(base + sizeof(SqbFileHeader) + k * block_bytes());
+    }
+    void* payload(uint64_t k) const { return block(k) + 1; }
+    // Every block is full except possibly the last
+    uint32_t expected_count(uint64_t k) const {
+        return (uint32_t)std::min<uint64_t>(header()->block_elems, header()->total_elems - k * header()->block_elems);
+    }
+
+    static size_t file_size(uint32_t type, uint32_t block_elems, uint64_t blocks) {
+        return sizeof(SqbFileHeader) +
+               blocks * (sizeof(SqbBlockHeader) + block_elems * (type == SQB_F32 ? 4u : 8u));
+    }
+
+    bool map(const char* path, bool writable, size_t create_size = 0) {
+        fd = open(path, writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+        if (fd < 0) return false;
+        if (create_size && ftruncate(fd, (off_t)create_size) != 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) return false;
+        size = (size_t)st.st_size;
+        if (size < sizeof(SqbFileHeader)) { errno = EINVAL; return false; }
+        base = (char*)mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) { base = nullptr; return false; }
+        return true;
+    }
+
+    bool valid() const {
+        const SqbFileHeader* h = header();
+        return std::memcmp(h->magic, SQB_MAGIC, 8) == 0 && h->version == 1 &&
+               (h->type == SQB_F32 || h->type == SQB_F64) && h->block_elems > 0 &&
+               h->block_count == (h->total_elems + h->block_elems - 1) / h->block_elems &&
+               size == file_size(h->type, h->block_elems, h->block_count);
+    }
+
+    void init_header(uint32_t type, uint32_t block_elems, uint64_t total) {
+        SqbFileHeader* h = header();
+        std::memset(h, 0, sizeof(*h));
+        std::memcpy(h->magic, SQB_MAGIC, 8);
+        h->version = 1;
+        h->type = type;
+        h->block_elems = block_elems;
+        h->total_elems = total;
+        h->block_count = (total + block_elems - 1) / block_elems;
+    }
+};
+
+static int sqb_pack(const char* in_path, const char* out_path, uint32_t type, uint32_t block_elems) {
+    int fd = open(in_path, O_RDONLY);
+    if (fd < 0) { std::perror(in_path); return 1; }
+    struct stat st;
+    if (fstat(fd, &st) != 0) { std::perror(in_path); return 1; }
+    const size_t elem = type == SQB_F32 ? 4 : 8;
+    const size_t size = (size_t)st.st_size;
+    if (size % elem != 0) {
+        std::cerr << "sqrt sqb: " << in_path << " is not a whole number of " << elem << "-byte values\n";
+        return 1;
+    }
+    const char* raw = nullptr;
+    if (size > 0) {
+        raw = (const char*)mmap(nullptr, size, PROT_READ, MAP_SHARED | MAP_POPULATE, fd, 0);
+        if (raw == MAP_FAILED) { std::perror("mmap"); return 1; }
+    }
+
+    const uint64_t total = size / elem;
+    const uint64_t blocks = (total + block_elems - 1) / block_elems;
+    SqbFile out;
+    if (unlink(out_path) != 0 && errno != ENOENT) { std::perror(out_path); return 1; }
+    if (!out.map(out_path, true, SqbFile::file_size(type, block_elems, blocks))) { std::perror(out_path); return 1; }
+    out.init_header(type, block_elems, total);
+    for (uint64_t k = 0; k < blocks; k++) {
+        uint32_t count = out.expected_count(k);
+        SqbBlockHeader* h = out.block(k);
+        std::memset(h, 0, sizeof(*h));
+        std::memcpy(out.payload(k), raw + k * block_elems * elem, count * elem);
+        if (type == SQB_F32) sqb_describe((const float*)out.payload(k), count, h);
+        else sqb_describe((const double*)out.payload(k), count, h);
+    }
+    if (raw) munmap((void*)raw, size);
+    close(fd);
+    return 0;
+}
+
+static int sqb_unpack(const char* in_path, const char* out_path) {
+    SqbFile in;
+    if (!in.map(in_path, false) || !in.valid()) { std::cerr << "sqrt sqb: " << in_path << ": not a valid .sqb file\n"; return 1; }
+    int fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) { std::perror(out_path); return 1; }
+    for (uint64_t k = 0; k < in.header()->block_count; k++) {
+        if (in.block(k)->count != in.expected_count(k)) {
+            std::cerr << "sqrt sqb: " << in_path << ": block " << k << " has a bad element count\n";
+            close(fd);
+            return 1;
+        }
+        if (!write_all(fd, (const char*)in.payload(k), in.block(k)->count * in.elem_size())) { std::perror("write"); return 1; }
+    }
+    if (close(fd) != 0) { std::perror("close"); return 1; }
+    return 0;
+}
+
+static int sqb_info(const char* path) {
+    SqbFile f;
+    if (!f.map(path, false) || !f.valid()) { std::cerr << "sqrt sqb: " << path << ": not a valid .sqb file\n"; return 1; }
+    const SqbFileHeader* h = f.header();
+    std::cout << path << ": " << (h->type == SQB_F32 ? "f32" : "f64") << ", " << h->total_elems << " elements in "
+              << h->block_count << " blocks of " << h->block_elems << "\n";
+    std::cout << std::setw(8) << "block" << std::setw(10) << "count" << std::setw(14) << "exp range"
+              << std::setw(8) << "clean" << std::setw(12) << "flags" << std::setw(12) << "crc32c"
+              << std::setw(10) << "tier" << "\n";
+    for (uint64_t k = 0; k < h->block_count; k++) {
+        const SqbBlockHeader* b = f.block(k);
+        std::string flags;
+        if (b->flags & SQB_HAS_NEGATIVE) flags += "-";
+        if (b->flags & SQB_HAS_ZERO) flags += "0";
+        if (b->flags & SQB_HAS_SUBNORMAL) flags += "s";
+        if (b->flags & SQB_HAS_NONFINITE) flags += "n";
+        std::ostringstream range, crc;
+        range << "[" << b->min_exp << ", " << b->max_exp << "]";
+        crc << std::hex << std::setw(8) << std::setfill('0') << b->checksum;
+        std::cout << std::setw(8) << k << std::setw(10) << b->count << std::setw(14) << range.str()
+                  << std::setw(8) << (sqb_clean(*b, SQRT_EXACT) ? "yes" : "no")
+                  << std::setw(12) << (flags.empty() ? "." : flags) << std::setw(12) << crc.str()
+                  << std::setw(10) << (b->tier ? tier_name((SqrtTier)(b->tier - 1)) : "input") << "\n";
+    }
+    return 0;
+}
+
+static int sqb_root(const char* in_path, const char* out_path, unsigned threads, SqrtTier tier) {
+    SqbFile in;
+    if (!in.map(in_path, false) || !in.valid()) { std::cerr << "sqrt sqb: " << in_path << ": not a valid .sqb file\n"; return 1; }
+    const SqbFileHeader ih = *in.header();
+    const size_t out_size = SqbFile::file_size(ih.type, ih.block_elems, ih.block_count);
+
+    // Reuse an existing output with the same geometry, so unchanged blocks can be skipped
+    SqbFile out;
+    bool reuse = false;
+    {
+        SqbFile prev;
+        if (prev.map(out_path, false) && prev.valid()) {
+            const SqbFileHeader* ph = prev.header();
+            reuse = ph->type == ih.type && ph->block_elems == ih.block_elems && ph->total_elems == ih.total_elems;
+        }
+    }
+    if (!reuse && unlink(out_path) != 0 && errno != ENOENT) { std::perror(out_path); return 1; }
+    if (!out.map(out_path, true, reuse ? 0 : out_size)) { std::perror(out_path); return 1; }
+    if (!reuse) out.init_header(ih.type, ih.block_elems, ih.total_elems);
+
+    std::atomic<uint64_t> computed{0}, clean{0}, corrupt{0};
+    ThreadPool pool(threads);
+    pool.parallel_for(ih.block_count, [&](size_t k) {
+        const SqbBlockHeader& ib = *in.block(k);
+        SqbBlockHeader& ob = *out.block(k);
+        // A bad count would read or write past the block, so treat it as corruption
+        if (ib.count != in.expected_count(k)) {
+            corrupt++;
+            return;
+        }
+        if (reuse && ob.tier == (uint32_t)tier + 1 && ob.source_checksum == ib.checksum && ob.count == ib.count) return;
+
+        const size_t bytes = ib.count * in.elem_size();
+        if (crc32c(in.payload(k), bytes) != ib.checksum) {
+            corrupt++;
+            return;
+        }
+        bool is_clean = sqb_clean(ib, tier);
+        TraceScope span("sqb block", k);
+        SQRT_PROBE3(sqb_block, (uint64_t)k, (int)is_clean, (int)tier);
+        if (ih.type == SQB_F32) {
+            const float* src = (const float*)in.payload(k);
+            float* dst = (float*)out.payload(k);
+            if (is_clean) sqrt_batch_normal(src, dst, ib.count, tier);
+            else sqrt_batch(src, dst, ib.count, tier);
+            sqb_describe(dst, ib.count, &ob);
+        } else {
+            const double* src = (const double*)in.payload(k);
+            double* dst = (double*)out.payload(k);
+            if (is_clean) sqrt_batch_normal(src, dst, ib.count, tier);
+            else sqrt_batch(src, dst, ib.count, tier);
+            sqb_describe(dst, ib.count, &ob);
+        }
+        ob.source_checksum = ib.checksum;
+        ob.tier = (uint32_t)tier + 1;
+        computed++;
+        if (is_clean) clean++;
+    });
+
+    std::cerr << "sqrt sqb: " << computed << " of " << ih.block_count << " blocks recomputed ("
+              << clean << " clean), " << ih.block_count - computed - corrupt << " unchanged\n";
+    if (corrupt) {
+        std::cerr << "sqrt sqb: " << corrupt << " input blocks failed their count or checksum check\n";
+        return 1;
+    }
+    return 0;
+}
+
+int run_sqb(int argc, char** argv) {
+    const char* paths[2] = {nullptr, nullptr};
+    int npaths = 0;
+    uint32_t type = SQB_F64;
+    uint32_t block_elems = 65536;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    SqrtTier tier = SQRT_EXACT;
+    const char* cmd = argc > 0 ? argv[0] : "";
+    bool ok = true;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "-t") && i + 1 < argc) {
+            i++;
+            if (!std::strcmp(argv[i], "f32")) type = SQB_F32;
+            else if (!std::strcmp(argv[i], "f64")) type = SQB_F64;
+            else ok = false;
+        } else if (!std::strcmp(argv[i], "-B") && i + 1 < argc) {
+            block_elems = (uint32_t)std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "-j") && i + 1 < argc) {
+            threads = (unsigned)std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "-m") && i + 1 < argc) {
+            ok = ok && parse_tier(argv[++i], &tier);
+        } else if (argv[i][0] != '-' && npaths < 2) {
+            paths[npaths++] = argv[i];
+        } else {
+            ok = false;
+        }
+    }
+    if (ok && !std::strcmp(cmd, "pack") && npaths == 2) return sqb_pack(paths[0], paths[1], type, block_elems);
+    if (ok && !std::strcmp(cmd, "unpack") && npaths == 2) return sqb_unpack(paths[0], paths[1]);
+    if (ok && !std::strcmp(cmd, "info") && npaths == 1) return sqb_info(paths[0]);
+    if (ok && !std::strcmp(cmd, "root") && npaths == 2) return sqb_root(paths[0], paths[1], threads, tier);
+    std::cerr << "usage: sqrt sqb pack [-t f32|f64] [-B block_elems] raw_in out.sqb\n"
+              << "       sqrt sqb root [-j threads] [-m exact|optimal|fast] in.sqb out.sqb\n"
+              << "       sqrt sqb unpack in.sqb raw_out\n"
+              << "       sqrt sqb info file.sqb\n";
+    return 2;
+}
+
+// ==================== INCREMENTAL RECOMPUTE ====================
+// DerivedSqrtArray keeps roots()[i] == sqrt(input i) for a large persistent
+// array where only a small fraction of inputs change between reads. Every
+// 64-byte cache line of inputs (8 doubles) has a dirty bit. set() stores the
+// value and then sets the bit, two atomic operations and no lock, so any
+// number of writer threads can update concurrently. recompute() takes each
+// bitmap word with an atomic exchange and runs sqrt_batch over runs of
+// consecutive dirty lines only.
+//
+// recompute() may run while writers are active: a value stored after its
+// line was taken sets the bit again and is picked up by the next recompute.
+// The kernels read with plain vector loads, so each dirty run is first
+// copied out with atomic loads into a scratch buffer and rooted from there.
+
+class DerivedSqrtArray {
+public:
+    static const size_t LINE = 64 / sizeof(double);
+
+    explicit DerivedSqrtArray(size_t n, SqrtTier tier = SQRT_EXACT)
+        : n(n), lines((n + LINE - 1) / LINE), words((lines + 63) / 64), tier(tier),
+          in(alloc_lines(lines)), out(alloc_lines(lines)), dirty(new std::atomic<uint64_t>[words]) {
+        std::memset(in.get(), 0, lines * 64);
+        std::memset(out.get(), 0, lines * 64);
+        for (size_t w = 0; w < words; w++) dirty[w].store(0, std::memory_order_relaxed);
+    }
+
+    size_t size() const { return n; }
+    const double* roots() const { return out.get(); }
+    double root(size_t i) const { return out[i]; }
+
+    double input(size_t i) const {
+        double v;
+        __atomic_load(&in[i], &v, __ATOMIC_RELAXED);
+        return v;
+    }
+
+    // Lock-free; safe from any number of threads
+    void set(size_t i, double value) {
+        __atomic_store(&in[i], &value, __ATOMIC_RELAXED);
+        size_t line = i / LINE;
+        dirty[line / 64].fetch_or(1ULL << (line % 64), std::memory_order_release);
+    }
+
+    void mark_all() {
+        for (size_t w = 0; w < words; w++) {
+            size_t valid = std::min<size_t>(64, lines - w * 64);
+            dirty[w].fetch_or(valid == 64 ? ~0ULL : (1ULL << valid) - 1, std::memory_order_release);
+        }
+    }
+
+    // Recomputes the dirty lines and returns how many there were. With a
+    // pool, the bitmap is split into one range of words per task.
+    size_t recompute(ThreadPool* pool = nullptr) {
+        if (!pool || pool->size() == 1) return recompute_words(0, words);
+        const size_t tasks = std::min<size_t>(words, (size_t)pool->size() * 4);
+        std::atomic<size_t> total{0};
+        pool->parallel_for(tasks, [&](size_t t) {
+            total += recompute_words(words * t / tasks, words * (t + 1) / tasks);
+        });
+        return total.load();
+    }
+
+private:
+    struct FreeDeleter {
+        void operator()(double* p) const { std::free(p); }
+    };
+
+    static double* alloc_lines(size_t count) {
+        return (double*)std::aligned_alloc(64, std::max<size_t>(count, 1) * 64);
+    }
+
+    size_t recompute_words(size_t begin, size_t end) {
+        alignas(64) double scratch[64 * LINE];  // one bitmap word's worth of lines
+        size_t count = 0;
+        for (size_t w = begin; w < end; w++) {
+            if (dirty[w].load(std::memory_order_relaxed) == 0) continue;
+            uint64_t bits = dirty[w].exchange(0, std::memory_order_acquire);
+            while (bits) {
+                unsigned first = (unsigned)__builtin_ctzll(bits);
+                uint64_t rest = bits >> first;
+                unsigned run = ~rest ? (unsigned)__builtin_ctzll(~rest) : 64 - first;
+                size_t lo = (w * 64 + first) * LINE;
+                size_t hi = std::min(n, lo + (size_t)run * LINE);
+                for (size_t i = lo; i < hi; i++) __atomic_load(&in[i], &scratch[i - lo], __ATOMIC_RELAXED);
+                sqrt_batch(scratch, out.get() + lo, hi - lo, tier);
+                count += run;
+                bits = run + first >= 64 ? 0 : bits & (~0ULL << (first + run));
+            }
+        }
+        return count;
+    }
+
+    size_t n, lines, words;
+    SqrtTier tier;
+    std::unique_ptr<double[], FreeDeleter> in, out;
+    std::unique_ptr<std::atomic<uint64_t>[]> dirty;
+};
+
+// Full sqrt_batch pass vs DerivedSqrtArray::recompute for a few change rates
+void incremental_benchmark() {
+    const size_t N = 8 << 20;
+    const int TICKS = 20;
+    std::cout << "INCREMENTAL RECOMPUTE (" << N << " doubles, " << TICKS << " ticks):\n";
+    std::cout << std::string(60, '-') << "\n";
+
+    std::vector<double> plain(N), roots(N);
+    DerivedSqrtArray derived(N);
+    uint64_t seed = 88172645463325252ULL;
+    auto next = [&] { seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17; return seed; };
+    for (size_t i = 0; i < N; i++) {
+        plain[i] = 1.0 + (double)(next() % 1000000) / 100.0;
+        derived.set(i, plain[i]);
+    }
+    derived.recompute();
+
+    typedef std::chrono::high_resolution_clock clock;
+    auto start = clock::now();
+    for (int t = 0; t < TICKS; t++) sqrt_batch(plain.data(), roots.data(), N);
+    double full_ms = std::chrono::duration<double, std::milli>(clock::now() - start).count() / TICKS;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::setw(24) << "full recompute:" << std::setw(10) << full_ms << " ms/tick\n";
+
+    for (double rate : {0.0005, 0.005, 0.05}) {
+        size_t changes = (size_t)(N * rate);
+        double total_ms = 0;
+        size_t lines = 0;
+        for (int t = 0; t < TICKS; t++) {
+            for (size_t c = 0; c < changes; c++) {
+                size_t i = next() % N;
+                derived.set(i, 1.0 + (double)(next() % 1000000) / 100.0);
+            }
+            auto t0 = clock::now();
+            lines += derived.recompute();
+            total_ms += std::chrono::duration<double, std::milli>(clock::now() - t0).count();
+        }
+        std::ostringstream label;
+        label << std::setprecision(2) << rate * 100 << "% changed:";
+        std::cout << std::setw(24) << label.str() << std::setw(10) << total_ms / TICKS << " ms/tick  ("
+                  << std::setprecision(2) << full_ms / (total_ms / TICKS) << "x, "
+                  << std::setprecision(1) << 100.0 * (double)lines / TICKS / (N / DerivedSqrtArray::LINE)
+                  << "% of lines dirty)\n" << std::setprecision(3);
+    }
+    std::cout << "\n";
+}
+
+// ==================== MEMOIZATION CACHE ====================
+// Market data repeats: the same price levels and lot sizes come up over and
+// over. SqrtMemo is a small direct-mapped cache keyed by the input's bit
+// pattern, placed in front of one of the scalar methods. Each thread gets
+// its own (thread_memo), so lookups take no locks and no shared cache lines.
+// batch() probes 4 entries at once with AVX2 gathers and only calls the
+// wrapped method for lanes that miss.
+//
+// Whether it pays off depends on the method: it wins in front of the
+// division-heavy loops (sqrt_newton, sqrt_binary) on repetitive data and is
+// pure overhead in front of a packed kernel. See ./sqrt bench memo.
+
+template <double (*Fn)(double), unsigned Bits = 10>
+class SqrtMemo {
+public:
+    static const size_t ENTRIES = (size_t)1 << Bits;
+
+    SqrtMemo() {
+        // An all-ones key is a NaN; its cached root is NaN, so the empty
+        // entries never return a wrong answer even if that NaN is looked up.
+        for (size_t i = 0; i < ENTRIES; i++) {
+            keys[i] = ~0ULL;
+            values[i] = NAN;
+        }
+    }
+
+    double operator()(double x) {
+        uint64_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        size_t slot = index(bits);
+        if (keys[slot] == bits) {
+            hits++;
+            return values[slot];
+        }
+        misses++;
+        double r = Fn(x);
+        keys[slot] = bits;
+        values[slot] = r;
+        return r;
+    }
+
+    void batch(const double* in, double* out, size_t n) {
+        size_t i = 0;
+#if defined(__AVX2__)
+        const __m256i mask = _mm256_set1_epi64x((long long)(ENTRIES - 1));
+        for (; i + 4 <= n; i += 4) {
+            __m256i bits = _mm256_loadu_si256((const __m256i*)(in + i));
+            __m256i fold = _mm256_xor_si256(bits, _mm256_srli_epi64(bits, 32));
+            __m256i slot = _mm256_mul_epu32(fold, _mm256_set1_epi64x(0x9E3779B1));
+            slot = _mm256_and_si256(_mm256_srli_epi64(slot, 32 - Bits), mask);
+            __m256i cached = _mm256_i64gather_epi64((const long long*)keys, slot, 8);
+            __m256d value = _mm256_i64gather_pd(values, slot, 8);
+            int hit = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(cached, bits)));
+            hits += (uint64_t)__builtin_popcount(hit);
+            if (hit != 0xf) {
+                // Fill the missed lanes before the single store, so out may alias in
+                alignas(32) double lanes[4];
+                _mm256_store_pd(lanes, value);
+                for (int lane = 0; lane < 4; lane++) {
+                    if (!(hit & (1 << lane))) lanes[lane] = miss(in[i + lane]);
+                }
+                value = _mm256_load_pd(lanes);
+            }
+            _mm256_storeu_pd(out + i, value);
+        }
+#endif
+        for (; i < n; i++) out[i] = (*this)(in[i]);
+    }
+
+    uint64_t hits = 0, misses = 0;
+    double hit_rate() const { return hits + misses ? (double)hits / (double)(hits + misses) : 0.0; }
+    void reset_stats() { hits = misses = 0; }
+
+private:
+    static size_t index(uint64_t bits) {
+        // Inputs like 101.25 or 400.0 differ only in the exponent and top
+        // mantissa bits, so fold the high half down and hash multiplicatively
+        uint32_t fold = (uint32_t)(bits ^ (bits >> 32));
+        return (size_t)(((uint64_t)fold * 0x9E3779B1u & 0xffffffffu) >> (32 - Bits));
+    }
+
+    double miss(double x) {
+        uint64_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        size_t slot = index(bits);
+        misses++;
+        double r = Fn(x);
+        keys[slot] = bits;
+        values[slot] = r;
+        return r;
+    }
+
+    alignas(64) uint64_t keys[ENTRIES];
+    alignas(64) double values[ENTRIES];
+};
+
+template <double (*Fn)(double)>
+SqrtMemo<Fn>& thread_memo() {
+    thread_local SqrtMemo<Fn> memo;
+    return memo;
+}
+
+double sqrt_optimal_memo(double x) { return thread_memo<sqrt_optimal>()(x); }
+double sqrt_newton_memo(double x) { return thread_memo<sqrt_newton>()(x); }
+double sqrt_binary_memo(double x) { return thread_memo<sqrt_binary>()(x); }
+
+// Direct calls vs the memo cache on repeat-heavy and repeat-free inputs
+void memo_benchmark() {
+    const size_t N = 1 << 21;
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    auto next = [&] { seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17; return seed; };
+
+    // Zipf-like pick from a fixed set of levels: level k is drawn ~1/(k+1) as often as level 0
+    auto zipf = [&](const std::vector<double>& levels) {
+        std::vector<double> cdf(levels.size());
+        double sum = 0;
+        for (size_t k = 0; k < levels.size(); k++) cdf[k] = sum += 1.0 / (double)(k + 1);
+        std::vector<double> out(N);
+        for (double& v : out) {
+            double u = (double)(next() >> 11) * 0x1p-53 * sum;
+            v = levels[(size_t)(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin())];
+        }
+        return out;
+    };
+    auto levels = [](size_t count, double base, double tick) {
+        std::vector<double> v(count);
+        for (size_t k = 0; k < count; k++) v[k] = base + tick * (double)k;
+        return v;
+    };
+
+    struct Distribution { const char* name; std::vector<double> data; };
+    std::vector<Distribution> dists;
+    dists.push_back({"price ladder (200 levels)", zipf(levels(200, 101.25, 0.25))});
+    dists.push_back({"lot sizes (40 sizes)", zipf(levels(40, 100, 100))});
+    dists.push_back({"wide book (20k levels)", zipf(levels(20000, 50.0, 0.01))});
+    std::vector<double> unique(N);
+    for (double& v : unique) v = 1.0 + (double)(next() >> 11) * 0x1p-53 * 1e6;
+    dists.push_back({"no repeats (uniform)", unique});
+
+    typedef std::chrono::high_resolution_clock clock;
+    std::vector<double> out(N);
+    volatile double sink = 0;
+    auto ns_per = [&](auto&& body) {
+        auto t0 = clock::now();
+        body();
+        return std::chrono::duration<double, std::nano>(clock::now() - t0).count() / (double)N;
+    };
+
+    std::cout << "MEMO CACHE (" << N << " inputs per distribution, "
+              << SqrtMemo<sqrt_optimal>::ENTRIES << "-entry direct-mapped cache):\n";
+    std::cout << std::string(96, '-') << "\n";
+    std::cout << std::left << std::setw(28) << "distribution" << std::right << std::setw(8) << "hits"
+              << std::setw(20) << "sqrt_optimal" << std::setw(20) << "sqrt_newton" << std::setw(20) << "batch optimal" << "\n";
+    std::cout << std::left << std::setw(36) << "" << std::right << std::setw(20) << "direct / memo ns"
+              << std::setw(20) << "direct / memo ns" << std::setw(20) << "direct / memo ns" << "\n";
+    std::cout << std::string(96, '-') << "\n";
+    std::cout << std::fixed;
+
+    for (const Distribution& d : dists) {
+        const std::vector<double>& in = d.data;
+        SqrtMemo<sqrt_optimal>& memo = thread_memo<sqrt_optimal>();
+        SqrtMemo<sqrt_newton>& newton_memo = thread_memo<sqrt_newton>();
+        for (size_t i = 0; i < 4096; i++) { memo(in[i]); newton_memo(in[i]); }  // warm up
+        memo.reset_stats();
+
+        double opt_direct = ns_per([&] { for (size_t i = 0; i < N; i++) sink = sqrt_optimal(in[i]); });
+        double opt_memo = ns_per([&] { for (size_t i = 0; i < N; i++) sink = sqrt_optimal_memo(in[i]); });
+        double hit_rate = memo.hit_rate();
+        double newton_direct = ns_per([&] { for (size_t i = 0; i < N; i++) sink = sqrt_newton(in[i]); });
+        double newton_memo_ns = ns_per([&] { for (size_t i = 0; i < N; i++) sink = sqrt_newton_memo(in[i]); });
+        double batch_direct = ns_per([&] { sqrt_batch(in.data(), out.data(), N, SQRT_OPTIMAL); });
+        double batch_memo = ns_per([&] { memo.batch(in.data(), out.data(), N); });
+
+        auto pair = [](double a, double b) {
+            std::ostringstream s;
+            s << std::fixed << std::setprecision(2) << a << " / " << b << (b < a ? " +" : " -");
+            return s.str();
+        };
+        std::cout << std::left << std::setw(28) << d.name << std::right << std::setw(7) << std::setprecision(1)
+                  << hit_rate * 100 << "%" << std::setw(20) << pair(opt_direct, opt_memo)
+                  << std::setw(20) << pair(newton_direct, newton_memo_ns)
+                  << std::setw(20) << pair(batch_direct, batch_memo) << "\n";
+    }
+    (void)sink;
+    std::cout << "  (+ memo faster, - memo only adds latency)\n\n";
+}
+
+// ==================== PARETO EXPLORER ====================
+// sqrt pareto: enumerates the kernel design space -- seed (hardware rsqrt,
+// bit-hack, lookup table, cubic polynomial) x refinement (rsqrt Newton,
+// Goldschmidt, Heron's divide-and-average) x step count x FMA x float/double
+// -- measures max-ULP error against the correctly rounded root and
+// ns/element on this host, and prints the Pareto-optimal set. The library's
+// own kernels are points in this space, so where they sit is measured, not
+// asserted.
+//
+// Every variant scales exactly with x -> 4x, so the error over [1,4) is the
+// error over all normal inputs: floats are swept exhaustively there, doubles
+// sampled. Seeds only need float range (hardware rsqrt is single precision),
+// so timing inputs span the float normals.
+
+enum ParetoSeed { SEED_HW, SEED_BITHACK, SEED_LUT, SEED_POLY };
+enum ParetoIteration { ITER_NEWTON, ITER_GOLDSCHMIDT, ITER_HERON };
+static const char* const SEED_NAMES[] = {"hw-rsqrt", "bithack", "lut", "poly"};
+static const char* const ITERATION_NAMES[] = {"newton", "goldschmidt", "heron"};
+
+template <class T>
+static inline typename FloatBits<T>::U bits_of(T x) {
+    typename FloatBits<T>::U u;
+    std::memcpy(&u, &x, sizeof(u));
+    return u;
+}
+
+template <class T>
+static inline T from_bits(typename FloatBits<T>::U u) {
+    T x;
+    std::memcpy(&x, &u, sizeof(x));
+    return x;
+}
+
+// a*b + c and c - a*b, fused or with the product rounded first. GCC contracts
+// a*b + c into an FMA on its own, so the unfused form hides the product
+// behind an empty asm.
+#if defined(__x86_64__) || defined(__i386__)
+#define SCALAR_BARRIER(v) __asm__("" : "+x"(v))
+#else
+#define SCALAR_BARRIER(v) __asm__("" : "+w"(v))
+#endif
+
+template <bool Fma, class T>
+static inline T mul_add(T a, T b, T c) {
+    if (Fma) return std::fma(a, b, c);
+    T p = a * b;
+    SCALAR_BARRIER(p);
+    return p + c;
+}
+
+template <bool Fma, class T>
+static inline T neg_mul_add(T a, T b, T c) {
+    return mul_add<Fma>(-a, b, c);
+}
+
+// Seed tables: 1/sqrt at the midpoint of each of 128 mantissa intervals, for
+// even and odd exponents; cubic interpolating 1/sqrt(m) on [1,2) at the
+// Chebyshev nodes
+template <class T>
+struct ParetoTables {
+    T lut[256];
+    T poly[4];
+    T odd_scale[2];
+    ParetoTables() {
+        for (int odd = 0; odd < 2; odd++)
+            for (int j = 0; j < 128; j++)
+                lut[odd * 128 + j] = (T)(1 / std::sqrt((1 + (j + 0.5) / 128) * (odd ? 2 : 1)));
+        // Vandermonde solve at the four Chebyshev nodes of [1,2]
+        double a[4][5];
+        for (int i = 0; i < 4; i++) {
+            double node = 1.5 + 0.5 * std::cos(M_PI * (2 * i + 1) / 8);
+            for (int j = 0; j < 4; j++) a[i][j] = std::pow(node, j);
+            a[i][4] = 1 / std::sqrt(node);
+        }
+        for (int c = 0; c < 4; c++) {
+            for (int r = c + 1; r < 4; r++) {
+                double f = a[r][c] / a[c][c];
+                for (int j = c; j < 5; j++) a[r][j] -= f * a[c][j];
+            }
+        }
+        double coef[4];
+        for (int c = 3; c >= 0; c--) {
+            double s = a[c][4];
+            for (int j = c + 1; j < 4; j++) s -= a[c][j] * coef[j];
+            coef[c] = s / a[c][c];
+        }
+        for (int i = 0; i < 4; i++) poly[i] = (T)coef[i];
+        odd_scale[0] = 1;
+        odd_scale[1] = (T)std::sqrt(0.5);
+    }
+};
+
+template <class T>
+static const ParetoTables<T>& pareto_tables() {
+    static const ParetoTables<T> tables;
+    return tables;
+}
+
+// 2^(-k/2) for the even part k of x's exponent, and the parity bit
+template <class T>
+static inline T rsqrt_exponent_scale(typename FloatBits<T>::U bits, int* odd) {
+    typedef FloatBits<T> FB;
+    int k = (int)((bits >> FB::MANT) & FB::EXP_MAX) - FB::BIAS;
+    *odd = k & 1;
+    int half = (k - *odd) / 2;
+    return from_bits<T>((typename FB::U)(FB::BIAS - half) << FB::MANT);
+}
+
+template <class T, int Seed, bool Fma>
+static inline T seed_rsqrt(T x) {
+    typedef FloatBits<T> FB;
+    typename FB::U bits = bits_of(x);
+    if (Seed == SEED_HW) return (T)_mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss((float)x)));
+    if (Seed == SEED_BITHACK) {
+        const typename FB::U magic = sizeof(T) == 4 ? (typename FB::U)0x5f3759dfu : (typename FB::U)0x5fe6eb50c7b537a9ull;
+        return from_bits<T>(magic - (bits >> 1));
+    }
+    const ParetoTables<T>& t = pareto_tables<T>();
+    int odd;
+    T scale = rsqrt_exponent_scale<T>(bits, &odd);
+    if (Seed == SEED_LUT) return t.lut[(odd << 7) | (int)((bits >> (FB::MANT - 7)) & 127)] * scale;
+    const typename FB::U mant_mask = ((typename FB::U)1 << FB::MANT) - 1;
+    T m = from_bits<T>((bits & mant_mask) | ((typename FB::U)FB::BIAS << FB::MANT));
+    T p = mul_add<Fma>(mul_add<Fma>(mul_add<Fma>(t.poly[3], m, t.poly[2]), m, t.poly[1]), m, t.poly[0]);
+    return p * t.odd_scale[odd] * scale;
+}
+
+template <class T, int Seed, bool Fma>
+static inline T seed_sqrt(T x) {
+    if (Seed != SEED_BITHACK) return x * seed_rsqrt<T, Seed, Fma>(x);
+    // The sqrt_bithack / sqrt_optimal seed: halve the biased exponent
+    typedef FloatBits<T> FB;
+    return from_bits<T>((bits_of(x) >> 1) + (((typename FB::U)FB::BIAS << FB::MANT) >> 1));
+}
+
+template <class T, int Seed, int Iteration, bool Fma, int Steps>
+static inline T pareto_sqrt(T x) {
+    const T half = (T)0.5;
+    if (Iteration == ITER_HERON) {
+        T s = seed_sqrt<T, Seed, Fma>(x);
+        for (int i = 0; i < Steps; i++) s = Fma ? std::fma(s, half, half * x / s) : half * (s + x / s);
+        return s;
+    }
+    T y = seed_rsqrt<T, Seed, Fma>(x);
+    if (Iteration == ITER_NEWTON) {
+        // y += y * (1/2 - x/2 * y^2)
+        T hx = half * x;
+        for (int i = 0; i < Steps; i++) y = mul_add<Fma>(y, neg_mul_add<Fma>(hx * y, y, half), y);
+        return x * y;
+    }
+    // Goldschmidt: g -> sqrt(x) and h -> 1/(2 sqrt(x)) together
+    T g = x * y, h = half * y;
+    for (int i = 0; i < Steps; i++) {
+        T r = neg_mul_add<Fma>(g, h, half);
+        g = mul_add<Fma>(g, r, g);
+        h = mul_add<Fma>(h, r, h);
+    }
+    return g;
+}
+
+template <class T, int Seed, int Iteration, bool Fma, int Steps>
+static void pareto_run(const void* in, void* out, size_t n) {
+    const T* src = (const T*)in;
+    T* dst = (T*)out;
+    for (size_t i = 0; i < n; i++) {
+        T r = pareto_sqrt<T, Seed, Iteration, Fma, Steps>(src[i]);
+        // Keep the loop scalar: these are per-element kernels, and the
+        // hardware seed and unfused variants couldn't vectorize anyway
+        SCALAR_BARRIER(r);
+        dst[i] = r;
+    }
+}
+
+template <class T>
+static void pareto_run_hardware(const void* in, void* out, size_t n) {
+    const T* src = (const T*)in;
+    T* dst = (T*)out;
+    for (size_t i = 0; i < n; i++) {
+        T r = std::sqrt(src[i]);
+        SCALAR_BARRIER(r);
+        dst[i] = r;
+    }
+}
+
+struct ParetoCandidate {
+    bool f64;
+    int seed, iteration, steps;  // seed < 0: hardware sqrt instruction
+    bool fma;
+    void (*run)(const void* in, void* out, size_t n);
+    double max_ulp = 0, ns = 0;
+    bool frontier = false;
+};
+
+template <class T, int Seed, int Iteration, bool Fma, int... Steps>
+static void pareto_add(std::vector<ParetoCandidate>& v, std::integer_sequence<int, Steps...>) {
+    (v.push_back({sizeof(T) == 8, Seed, Iteration, Steps, Fma, pareto_run<T, Seed, Iteration, Fma, Steps>}), ...);
+}
+
+template <class T, int Seed, int Iteration>
+static void pareto_add_fma(std::vector<ParetoCandidate>& v) {
+    // Floats converge from any seed in 3 steps, doubles in 4
+    typedef std::make_integer_sequence<int, sizeof(T) == 4 ? 4 : 5> Steps;
+    pareto_add<T, Seed, Iteration, false>(v, Steps());
+#if defined(__FMA__)
+    pareto_add<T, Seed, Iteration, true>(v, Steps());
+#endif
+}
+
+template <class T, int Seed>
+static void pareto_add_seed(std::vector<ParetoCandidate>& v) {
+    pareto_add_fma<T, Seed, ITER_NEWTON>(v);
+    pareto_add_fma<T, Seed, ITER_GOLDSCHMIDT>(v);
+    pareto_add_fma<T, Seed, ITER_HERON>(v);
+}
+
+template <class T>
+static void pareto_candidates(std::vector<ParetoCandidate>& v) {
+    v.push_back({sizeof(T) == 8, -1, 0, 0, false, pareto_run_hardware<T>});
+    pareto_add_seed<T, SEED_HW>(v);
+    pareto_add_seed<T, SEED_BITHACK>(v);
+    pareto_add_seed<T, SEED_LUT>(v);
+    pareto_add_seed<T, SEED_POLY>(v);
+}
+
+static std::string pareto_name(const ParetoCandidate& c) {
+    if (c.seed < 0) return "hardware sqrt";
+    std::string name = std::string(SEED_NAMES[c.seed]) + " + " + std::to_string(c.steps) + " " +
+                       ITERATION_NAMES[c.iteration];
+    return c.fma ? name + " (fma)" : name;
+}
+
+// Library kernels that are points of the space
+static const char* pareto_library_kernel(const ParetoCandidate& c) {
+    if (c.seed == SEED_BITHACK && c.iteration == ITER_HERON && c.steps == 2 && !c.fma)
+        return c.f64 ? "sqrt_optimal" : "sqrt_bithack";
+    if (!c.f64 && c.seed == SEED_HW && c.iteration == ITER_NEWTON && c.steps == 1 && !c.fma) return "sqrt_sse_fast";
+    if (c.seed < 0) return c.f64 ? "std::sqrt" : "sqrt_sse_exact";
+    return nullptr;
+}
+
+// Max ULP distance from the correctly rounded root over inputs [begin, end)
+// of a sweep; chunked so every candidate reuses the same reference roots
+template <class T>
+static void pareto_error_range(std::vector<ParetoCandidate*>& cands, std::vector<double>& max_ulp, uint64_t begin,
+                               uint64_t end, uint64_t samples) {
+    const size_t CHUNK = 4096;
+    typedef typename FloatBits<T>::U U;
+    std::vector<T> in(CHUNK), ref(CHUNK), out(CHUNK);
+    std::mt19937_64 rng(begin);
+    const U one = bits_of((T)1), span = bits_of((T)4) - one;
+    for (uint64_t base = begin; base < end; base += CHUNK) {
+        size_t n = (size_t)std::min<uint64_t>(CHUNK, end - base);
+        for (size_t i = 0; i < n; i++) {
+            // Exhaustive when the sweep covers [1,4); random otherwise
+            U offset = samples == (uint64_t)span ? (U)(base + i) : (U)(rng() % span);
+            in[i] = from_bits<T>(one + offset);
+            ref[i] = std::sqrt(in[i]);
+        }
+        for (size_t k = 0; k < cands.size(); k++) {
+            cands[k]->run(in.data(), out.data(), n);
+            double worst = max_ulp[k];
+            for (size_t i = 0; i < n; i++) {
+                U a = bits_of(out[i]), b = bits_of(ref[i]);
+                double ulp = std::isfinite(out[i]) && out[i] > 0 ? (double)(a > b ? a - b : b - a) : INFINITY;
+                worst = std::max(worst, ulp);
+            }
+            max_ulp[k] = worst;
+        }
+    }
+}
+
+template <class T>
+static void pareto_measure(std::vector<ParetoCandidate*>& cands, ThreadPool& pool, uint64_t f64_samples) {
+    const uint64_t span = bits_of((T)4) - bits_of((T)1);
+    const uint64_t samples = sizeof(T) == 4 ? span : f64_samples;
+
+    std::vector<std::vector<double>> worst(pool.size(), std::vector<double>(cands.size(), 0.0));
+    pool.parallel_for(pool.size(), [&](size_t t) {
+        uint64_t begin = samples * t / pool.size(), end = samples * (t + 1) / pool.size();
+        pareto_error_range<T>(cands, worst[t], begin, end, samples);
+    });
+    for (size_t k = 0; k < cands.size(); k++)
+        for (size_t t = 0; t < pool.size(); t++) cands[k]->max_ulp = std::max(cands[k]->max_ulp, worst[t][k]);
+
+    // Throughput over log-uniform inputs across the float normals
+    const size_t N = 4096;
+    const int REPS = 16, SAMPLES = 9;
+    std::vector<T> in(N), out(N);
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> exponent(-37, 37);
+    for (T& x : in) x = (T)std::pow(10.0, exponent(rng));
+    for (ParetoCandidate* c : cands) {
+        std::vector<double> ns;
+        c->run(in.data(), out.data(), N);  // warm up
+        for (int s = 0; s < SAMPLES; s++) {
+            auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < REPS; r++) {
+                c->run(in.data(), out.data(), N);
+                __asm__ volatile("" : : "r"(out.data()) : "memory");
+            }
+            ns.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                         (REPS * N));
+        }
+        c->ns = median_of(ns);
+    }
+}
+
+// A candidate is on the frontier unless another is at least as accurate and
+// as fast, and strictly better in one
+static void pareto_frontier(std::vector<ParetoCandidate*>& cands) {
+    for (ParetoCandidate* a : cands) {
+        a->frontier = true;
+        for (ParetoCandidate* b : cands) {
+            if (b != a && b->max_ulp <= a->max_ulp && b->ns <= a->ns && (b->max_ulp < a->max_ulp || b->ns < a->ns)) {
+                a->frontier = false;
+                break;
+            }
+        }
+    }
+}
+
+int run_pareto(int argc, char** argv) {
+    bool show_all = false, want_f32 = true, want_f64 = true;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t f64_samples = 1 << 22;
+    for (int i = 0; i < argc; i++) {
+        if (!std::strcmp(argv[i], "-a")) {
+            show_all = true;
+        } else if (!std::strcmp(argv[i], "-t") && i + 1 < argc) {
+            i++;
+            want_f32 = !std::strcmp(argv[i], "f32");
+            want_f64 = !std::strcmp(argv[i], "f64");
+            if (!want_f32 && !want_f64) { std::cerr << "unknown type: " << argv[i] << "\n"; return 2; }
+        } else if (!std::strcmp(argv[i], "-j") && i + 1 < argc) {
+            threads = (unsigned)std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+            f64_samples = (uint64_t)std::max(1LL, std::atoll(argv[++i]));
+        } else {
+            std::cerr << "usage: sqrt pareto [-t f32|f64] [-a] [-j threads] [-n f64_samples]\n";
+            return 2;
+        }
+    }
+
+    // The pool's threads exist before the preflight pins this one
+    ThreadPool pool(threads);
+    BenchEnvironment env;
+    if (!preflight_or_refuse(true, &env, std::cout)) return 1;
+
+    std::vector<ParetoCandidate> all;
+    if (want_f32) pareto_candidates<float>(all);
+    if (want_f64) pareto_candidates<double>(all);
+
+    std::cout << "PARETO FRONTIER (max ULP vs correctly rounded: f32 exhaustive over [1,4), f64 " << f64_samples
+              << " samples; ns/element over 4096 inputs)\n";
+    for (int f64 = 0; f64 < 2; f64++) {
+        std::vector<ParetoCandidate*> cands;
+        for (ParetoCandidate& c : all) if (c.f64 == (bool)f64) cands.push_back(&c);
+        if (cands.empty()) continue;
+        if (f64) pareto_measure<double>(cands, pool, f64_samples);
+        else pareto_measure<float>(cands, pool, f64_samples);
+        pareto_frontier(cands);
+        std::sort(cands.begin(), cands.end(),
+                  [](const ParetoCandidate* a, const ParetoCandidate* b) { return a->ns < b->ns; });
+
+        std::cout << std::string(86, '-') << "\n"
+                  << (f64 ? "f64" : "f32") << std::setw(37) << "kernel" << std::setw(14) << "max ulp"
+                  << std::setw(12) << "ns/elem" << "\n";
+        for (ParetoCandidate* c : cands) {
+            const char* library = pareto_library_kernel(*c);
+            if (!show_all && !c->frontier && !library) continue;
+            std::cout << (c->frontier ? "  * " : "    ") << std::left << std::setw(36) << pareto_name(*c)
+                      << std::right << std::setw(14);
+            if (std::isinf(c->max_ulp)) std::cout << "inf";
+            else if (c->max_ulp >= 1e7) std::cout << std::scientific << std::setprecision(2) << c->max_ulp;
+            else std::cout << std::fixed << std::setprecision(0) << c->max_ulp;
+            std::cout << std::fixed << std::setprecision(3) << std::setw(12) << c->ns;
+            if (library) std::cout << "  = " << library << (c->frontier ? "" : " (dominated)");
+            std::cout << "\n";
+        }
+    }
+    std::cout << "\n* Pareto-optimal: no other variant is both as accurate and as fast"
+              << (show_all ? "" : " (-a lists every variant)") << "\n";
+    if (preflight_mode() != PREFLIGHT_OFF) preflight_recheck(env, std::cout);
+    return 0;
+}
+
+// ==================== RANGE-SPECIALIZED KERNELS ====================
+// When inputs are statically known to be positive normals in a bounded range
+// (volatilities, prices), the general kernels' sign/zero/one checks are dead
+// weight, and a range inside the float normals makes the hardware rsqrt seed
+// valid for doubles too. sqrt_in_range<Range>(x) is that kernel: no branches,
+// a fixed hardware seed and a fixed number of FMA steps, each picked from the
+// sqrt pareto frontier. ./sqrt bench range re-proves the error bound over the
+// range (exhaustively for float) and times it against the general kernels.
+//
+// A range is a tag type with constexpr bounds:
+//     struct MyRange { static constexpr double lo = 1e-3, hi = 1e4; };
+
+struct Range1e6 {
+    static constexpr double lo = 1e-6, hi = 1e6;
+};
+
+// Fixed seed/step choice per precision and the error bound it guarantees
+template <class T> struct RangeKernel;
+template <> struct RangeKernel<float> {
+    static const int ITERATION = ITER_GOLDSCHMIDT, STEPS = 1;
+    static constexpr double MAX_ULP = 3;
+};
+template <> struct RangeKernel<double> {
+    static const int ITERATION = ITER_NEWTON, STEPS = 2;
+    static constexpr double MAX_ULP = 256;
+};
+
+#if defined(__FMA__)
+static const bool RANGE_FMA = true;
+#else
+static const bool RANGE_FMA = false;
+#endif
+
+template <class Range, class T>
+inline T sqrt_in_range(T x) {
+    static_assert(Range::lo >= FLT_MIN && Range::hi <= FLT_MAX && Range::lo <= Range::hi,
+                  "range must lie in the positive float normals (hardware rsqrt seed)");
+    return pareto_sqrt<T, SEED_HW, RangeKernel<T>::ITERATION, RANGE_FMA, RangeKernel<T>::STEPS>(x);
+}
+
+struct RangeProof {
+    double max_ulp, max_rel;
+    uint64_t inputs;
+    bool exhaustive;
+};
+
+template <class T>
+static void range_error(T x, double* max_ulp, double* max_rel, T (*kernel)(T)) {
+    T r = kernel(x), ref = std::sqrt(x);
+    typename FloatBits<T>::U a = bits_of(r), b = bits_of(ref);
+    *max_ulp = std::max(*max_ulp, std::isfinite(r) ? (double)(a > b ? a - b : b - a) : INFINITY);
+    *max_rel = std::max(*max_rel, std::abs((double)r - (double)ref) / (double)ref);
+}
+
+// Every float in [lo, hi]
+static RangeProof range_proof_f32(float lo, float hi, float (*kernel)(float), ThreadPool& pool) {
+    const uint32_t first = bits_of(lo), last = bits_of(hi);
+    const uint64_t count = (uint64_t)last - first + 1;
+    std::vector<RangeProof> part(pool.size(), RangeProof{0, 0, 0, true});
+    pool.parallel_for(pool.size(), [&](size_t t) {
+        uint64_t begin = first + count * t / pool.size(), end = first + count * (t + 1) / pool.size();
+        for (uint64_t b = begin; b < end; b++)
+            range_error<float>(from_bits<float>((uint32_t)b), &part[t].max_ulp, &part[t].max_rel, kernel);
+    });
+    RangeProof p{0, 0, count, true};
+    for (const RangeProof& q : part) {
+        p.max_ulp = std::max(p.max_ulp, q.max_ulp);
+        p.max_rel = std::max(p.max_rel, q.max_rel);
+    }
+    return p;
+}
+
+template <class Range>
+static RangeProof range_proof_f32(ThreadPool& pool) {
+    float lo = (float)Range::lo, hi = (float)Range::hi;
+    if (lo < Range::lo) lo = std::nextafter(lo, INFINITY);
+    if (hi > Range::hi) hi = std::nextafter(hi, 0.0f);
+    return range_proof_f32(lo, hi, sqrt_in_range<Range, float>, pool);
+}
+
+// Doubles can't be enumerated: the kernel scales exactly under x -> 4x, so
+// sample [1,4) densely, plus log-uniform points and the endpoints of the range
+static RangeProof range_proof_f64(double lo, double hi, double (*kernel)(double), uint64_t samples) {
+    RangeProof p{0, 0, 0, false};
+    std::mt19937_64 rng(0x7a11);
+    const uint64_t one = bits_of(1.0), span = bits_of(4.0) - one;
+    std::uniform_real_distribution<double> exponent(std::log10(lo), std::log10(hi));
+    auto check = [&](double x) {
+        if (x < lo || x > hi) return;
+        range_error<double>(x, &p.max_ulp, &p.max_rel, kernel);
+        p.inputs++;
+    };
+    for (uint64_t i = 0; i < samples; i++) check(from_bits<double>(one + rng() % span));
+    for (uint64_t i = 0; i < samples / 4; i++) check(std::pow(10.0, exponent(rng)));
+    check(lo);
+    check(hi);
+    return p;
+}
+
+template <class Range>
+static RangeProof range_proof_f64(uint64_t samples) {
+    return range_proof_f64(Range::lo, Range::hi, sqrt_in_range<Range, double>, samples);
+}
+
+static void print_range_proof(const char* kernel, const RangeProof& p, double bound) {
+    std::cout << "  " << std::left << std::setw(32) << kernel << std::right << std::setw(8) << std::fixed
+              << std::setprecision(0) << p.max_ulp << " ulp" << std::setw(11) << std::scientific << std::setprecision(2)
+              << p.max_rel << std::setw(13) << p.inputs << (p.exhaustive ? " (all)    " : " (sampled)")
+              << "  bound " << std::fixed << std::setprecision(0) << bound << " ulp: "
+              << (p.max_ulp <= bound ? (p.exhaustive ? "PROVEN" : "holds") : "VIOLATED") << "\n";
+}
+
+void range_benchmark() {
+    ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    std::cout << "RANGE-SPECIALIZED KERNELS (Range1e6: positive normals in [1e-6, 1e6])\n";
+    std::cout << std::string(96, '-') << "\n";
+    std::cout << "  " << std::left << std::setw(32) << "kernel" << std::right << std::setw(12) << "max error"
+              << std::setw(11) << "max rel" << std::setw(13) << "inputs" << "\n";
+    print_range_proof("sqrt_in_range<Range1e6, float>", range_proof_f32<Range1e6>(pool), RangeKernel<float>::MAX_ULP);
+    print_range_proof("sqrt_in_range<Range1e6, double>", range_proof_f64<Range1e6>(1 << 24),
+                      RangeKernel<double>::MAX_ULP);
+
+    // Log-uniform inputs across the range, timed like the speed test
+    std::vector<float> data(1000);
+    std::mt19937_64 rng(7);
+    std::uniform_real_distribution<double> exponent(-6, 6);
+    for (float& x : data) x = (float)std::pow(10.0, exponent(rng));
+    const SpeedKernel kernels[] = {
+        {"sqrt_optimal", speed_loop<double, double, sqrt_optimal>},
+        {"sqrt_in_range<double>", speed_loop<double, double, sqrt_in_range<Range1e6, double>>},
+        {"sqrt_bithack", speed_loop<float, float, sqrt_bithack>},
+        {"sqrt_in_range<float>", speed_loop<float, float, sqrt_in_range<Range1e6, float>>},
+    };
+    std::vector<std::vector<double>> samples = measure_interleaved(kernels, 4, data.data(), data.size(), 1000000, 21);
+    std::cout << "\n  median ns/call [95% CI], range kernel vs the general kernel above it:\n";
+    for (size_t k = 0; k < 4; k++) {
+        SampleStats s = summarize(samples[k]);
+        std::cout << "  " << std::left << std::setw(24) << kernels[k].name << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(8) << s.median << " ns [" << s.lo << ", " << s.hi << "]";
+        if (k % 2) std::cout << "  " << describe_comparison(compare_samples(samples[k - 1], samples[k]));
+        std::cout << "\n";
+    }
+}
+
+// ==================== MULTI-INPUT SCALAR API ====================
+// For call sites with a handful of independent roots but no array (the legs
+// of a quote, a few risk factors): sqrt2/sqrt4/sqrt8 take the values as
+// arguments and return them as a std::array, so
+//     auto [bid_vol, ask_vol] = sqrt2(bid_var, ask_var);
+// They compute sqrt_optimal bit for bit, but the two dependent Newton steps
+// of each value run side by side in one SSE2/AVX2 register instead of one
+// chain after another. sqrt_optimal_n<N> is the portable form: the chains
+// are interleaved in scalar code and the compiler schedules them together.
+
+template <size_t N>
+inline std::array<double, N> sqrt_optimal_n(const std::array<double, N>& x) {
+    std::array<double, N> g;
+    for (size_t i = 0; i < N; i++) {
+        uint64_t bits;
+        std::memcpy(&bits, &x[i], sizeof(bits));
+        bits = (bits >> 1) + (0x3ff0000000000000ULL >> 1);
+        std::memcpy(&g[i], &bits, sizeof(bits));
+    }
+    for (size_t i = 0; i < N; i++) g[i] = 0.5 * (g[i] + x[i] / g[i]);
+    for (size_t i = 0; i < N; i++) g[i] = 0.5 * (g[i] + x[i] / g[i]);
+    for (size_t i = 0; i < N; i++) g[i] = x[i] < 0 ? NAN : x[i] == 0 ? 0 : g[i];
+    return g;
+}
+
+// Two lanes of sqrt_optimal in SSE2
+static inline __m128d sqrt_optimal_pd2(__m128d x) {
+    __m128i bits = _mm_castpd_si128(x);
+    bits = _mm_add_epi64(_mm_srli_epi64(bits, 1), _mm_set1_epi64x((long long)(0x3ff0000000000000ULL >> 1)));
+    __m128d guess = _mm_castsi128_pd(bits);
+
+    const __m128d half = _mm_set1_pd(0.5);
+    guess = _mm_mul_pd(half, _mm_add_pd(guess, _mm_div_pd(x, guess)));
+    guess = _mm_mul_pd(half, _mm_add_pd(guess, _mm_div_pd(x, guess)));
+
+    const __m128d zero = _mm_setzero_pd();
+    __m128d negative = _mm_cmplt_pd(x, zero);
+    guess = _mm_or_pd(_mm_andnot_pd(negative, guess), _mm_and_pd(negative, _mm_set1_pd(NAN)));
+    return _mm_andnot_pd(_mm_cmpeq_pd(x, zero), guess);
+}
+
+inline std::array<double, 2> sqrt2(double a, double b) {
+    std::array<double, 2> r;
+    _mm_storeu_pd(r.data(), sqrt_optimal_pd2(_mm_set_pd(b, a)));
+    return r;
+}
+
+inline std::array<double, 4> sqrt4(double a, double b, double c, double d) {
+#if defined(__AVX2__)
+    std::array<double, 4> r;
+    _mm256_storeu_pd(r.data(), sqrt_optimal_pd(_mm256_set_pd(d, c, b, a)));
+    return r;
+#else
+    return sqrt_optimal_n<4>({a, b, c, d});
+#endif
+}
+
+inline std::array<double, 8> sqrt8(double a, double b, double c, double d, double e, double f, double g, double h) {
+#if defined(__AVX2__)
+    std::array<double, 8> r;
+    __m256d lo = sqrt_optimal_pd(_mm256_set_pd(d, c, b, a));
+    __m256d hi = sqrt_optimal_pd(_mm256_set_pd(h, g, f, e));
+    _mm256_storeu_pd(r.data(), lo);
+    _mm256_storeu_pd(r.data() + 4, hi);
+    return r;
+#else
+    return sqrt_optimal_n<8>({a, b, c, d, e, f, g, h});
+#endif
+}
+
+// Latency mode for sqrt2/4/8: every round's inputs wait on the previous
+// round's roots (x + r * 0 can't be folded), so the time per round is the
+// length of the dependency chain, not throughput. ns per round of N roots.
+enum MultiMode { MULTI_SEQUENTIAL, MULTI_INTERLEAVED, MULTI_PACKED };
+
+template <size_t N>
+static inline std::array<double, N> sqrt_packed_n(const std::array<double, N>& x) {
+    if constexpr (N == 2) return sqrt2(x[0], x[1]);
+    else if constexpr (N == 4) return sqrt4(x[0], x[1], x[2], x[3]);
+    else return sqrt8(x[0], x[1], x[2], x[3], x[4], x[5], x[6], x[7]);
+}
+
+template <size_t N, int Mode>
+static double multi_latency_loop(const float* data, size_t size, int iterations, const void*) {
+    std::array<double, N> x, r;
+    for (size_t i = 0; i < N; i++) {
+        x[i] = data[i % size];
+        r[i] = 0;
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int it = 0; it < iterations; it++) {
+        std::array<double, N> in;
+        for (size_t i = 0; i < N; i++) in[i] = x[i] + r[i] * 0.0;
+        if (Mode == MULTI_SEQUENTIAL) {
+            for (size_t i = 0; i < N; i++) r[i] = sqrt_optimal(in[i]);
+        } else if (Mode == MULTI_INTERLEAVED) {
+            r = sqrt_optimal_n<N>(in);
+        } else {
+            r = sqrt_packed_n<N>(in);
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    volatile double sink = r[0];
+    (void)sink;
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+void multi_benchmark() {
+    std::vector<float> data;
+    for (int i = 0; i < 8; i++) data.push_back(0.37f + 1.9f * (float)i);
+    const SpeedKernel kernels[] = {
+        {"2 x sqrt_optimal", multi_latency_loop<2, MULTI_SEQUENTIAL>},
+        {"sqrt_optimal_n<2>", multi_latency_loop<2, MULTI_INTERLEAVED>},
+        {"sqrt2", multi_latency_loop<2, MULTI_PACKED>},
+        {"4 x sqrt_optimal", multi_latency_loop<4, MULTI_SEQUENTIAL>},
+        {"sqrt_optimal_n<4>", multi_latency_loop<4, MULTI_INTERLEAVED>},
+        {"sqrt4", multi_latency_loop<4, MULTI_PACKED>},
+        {"8 x sqrt_optimal", multi_latency_loop<8, MULTI_SEQUENTIAL>},
+        {"sqrt_optimal_n<8>", multi_latency_loop<8, MULTI_INTERLEAVED>},
+        {"sqrt8", multi_latency_loop<8, MULTI_PACKED>},
+    };
+    const size_t KERNELS = sizeof(kernels) / sizeof(kernels[0]);
+    std::vector<std::vector<double>> samples = measure_interleaved(kernels, KERNELS, data.data(), data.size(), 200000, 21);
+
+    std::cout << "MULTI-INPUT LATENCY (dependent rounds, median ns per round [95% CI], vs sequential calls):\n";
+    std::cout << std::string(96, '-') << "\n";
+    for (size_t k = 0; k < KERNELS; k++) {
+        SampleStats s = summarize(samples[k]);
+        std::cout << "  " << std::left << std::setw(20) << kernels[k].name << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(8) << s.median << " ns [" << s.lo << ", " << s.hi << "]";
+        if (k % 3) std::cout << "  " << describe_comparison(compare_samples(samples[k - k % 3], samples[k]));
+        std::cout << "\n";
+        if (k % 3 == 2 && k + 1 < KERNELS) std::cout << "\n";
+    }
+}
+
+// ==================== INTERVAL SQRT ====================
+// Guaranteed enclosures [lo, hi] of sqrt(x), i.e. the round-down and round-up
+// roots, without touching MXCSR. r = sqrt(x) is correctly rounded to nearest
+// and the residual x - r*r is exactly representable, so one FMA gives its
+// sign: positive means r is below the true root (hi = next_up(r)), negative
+// means above (lo = next_down(r)), zero means exact. Below 2^-968 the
+// residual can underflow, so both bounds step out one ulp instead: still an
+// enclosure, at most one ulp wider than directed rounding. x < 0 and NaN give
+// NaN bounds, +inf gives [inf, inf].
+
+static const double INTERVAL_TINY = 0x1p-968;
+
+static inline double next_up_positive(double r) {
+    return from_bits<double>(bits_of(r) + 1);
+}
+
+static inline double next_down_positive(double r) {
+    return from_bits<double>(bits_of(r) - 1);
+}
+
+inline void sqrt_interval(double x, double* lo, double* hi) {
+    double r = std::sqrt(x);
+    double residual = std::fma(-r, r, x);
+    if (x > 0 && x < INTERVAL_TINY) {
+        *lo = next_down_positive(r);
+        *hi = next_up_positive(r);
+        return;
+    }
+    *lo = residual < 0 ? next_down_positive(r) : r;
+    *hi = residual > 0 ? next_up_positive(r) : r;
+}
+
+#if defined(__AVX2__) && defined(__FMA__)
+static inline void sqrt_interval_pd(__m256d x, __m256d* lo, __m256d* hi) {
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d r = _mm256_sqrt_pd(x);
+    __m256d residual = _mm256_fnmadd_pd(r, r, x);
+    __m256i bits = _mm256_castpd_si256(r), one = _mm256_set1_epi64x(1);
+    __m256d up = _mm256_castsi256_pd(_mm256_add_epi64(bits, one));
+    __m256d down = _mm256_castsi256_pd(_mm256_sub_epi64(bits, one));
+    __m256d tiny = _mm256_and_pd(_mm256_cmp_pd(x, zero, _CMP_GT_OQ),
+                                 _mm256_cmp_pd(x, _mm256_set1_pd(INTERVAL_TINY), _CMP_LT_OQ));
+    __m256d go_down = _mm256_or_pd(_mm256_cmp_pd(residual, zero, _CMP_LT_OQ), tiny);
+    __m256d go_up = _mm256_or_pd(_mm256_cmp_pd(residual, zero, _CMP_GT_OQ), tiny);
+    *lo = _mm256_blendv_pd(r, down, go_down);
+    *hi = _mm256_blendv_pd(r, up, go_up);
+}
+#endif
+
+void sqrt_interval(const double* in, double* lo, double* hi, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+    for (; i + 4 <= n; i += 4) {
+        __m256d l, h;
+        sqrt_interval_pd(_mm256_loadu_pd(in + i), &l, &h);
+        _mm256_storeu_pd(lo + i, l);
+        _mm256_storeu_pd(hi + i, h);
+    }
+#endif
+    for (; i < n; i++) sqrt_interval(in[i], &lo[i], &hi[i]);
+}
+
+// The MXCSR alternatives the benchmark compares against: switch the
+// rounding mode around every element, or once per pass over the batch
+static inline double sqrt_rounded(double x, unsigned mode) {
+    unsigned saved = _mm_getcsr();
+    _mm_setcsr((saved & ~_MM_ROUND_MASK) | mode);
+    // volatile: the compiler doesn't model MXCSR, so pin the sqrt between the writes
+    __asm__ volatile("" : "+x"(x));
+    double r = _mm_cvtsd_f64(_mm_sqrt_sd(_mm_setzero_pd(), _mm_set_sd(x)));
+    __asm__ volatile("" : "+x"(r));
+    _mm_setcsr(saved);
+    return r;
+}
+
+static void sqrt_interval_mxcsr(const double* in, double* lo, double* hi, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        lo[i] = sqrt_rounded(in[i], _MM_ROUND_DOWN);
+        hi[i] = sqrt_rounded(in[i], _MM_ROUND_UP);
+    }
+}
+
+static void sqrt_interval_mxcsr_passes(const double* in, double* lo, double* hi, size_t n) {
+    unsigned saved = _mm_getcsr();
+    _mm_setcsr((saved & ~_MM_ROUND_MASK) | _MM_ROUND_DOWN);
+    for (size_t i = 0; i < n; i++) {
+        double x = in[i];
+        __asm__ volatile("" : "+x"(x));
+        lo[i] = _mm_cvtsd_f64(_mm_sqrt_sd(_mm_setzero_pd(), _mm_set_sd(x)));
+    }
+    _mm_setcsr((saved & ~_MM_ROUND_MASK) | _MM_ROUND_UP);
+    for (size_t i = 0; i < n; i++) {
+        double x = in[i];
+        __asm__ volatile("" : "+x"(x));
+        hi[i] = _mm_cvtsd_f64(_mm_sqrt_sd(_mm_setzero_pd(), _mm_set_sd(x)));
+    }
+    _mm_setcsr(saved);
+}
+
+static void sqrt_interval_scalar(const double* in, double* lo, double* hi, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        double x = in[i];
+        SCALAR_BARRIER(x);
+        sqrt_interval(x, &lo[i], &hi[i]);
+    }
+}
+
+void interval_benchmark() {
+    const size_t N = 4096;
+    std::vector<double> in(N), lo(N), hi(N), ref_lo(N), ref_hi(N);
+    std::mt19937_64 rng(11);
+    std::uniform_real_distribution<double> exponent(-300, 300);
+    for (double& x : in) x = std::pow(10.0, exponent(rng));
+    in[0] = 0; in[1] = 4; in[2] = 2; in[3] = 0x1p-1074; in[4] = 1e-300; in[5] = INFINITY;
+
+    // Check against directed rounding first
+    sqrt_interval_mxcsr(in.data(), ref_lo.data(), ref_hi.data(), N);
+    sqrt_interval(in.data(), lo.data(), hi.data(), N);
+    size_t exact = 0, widened = 0, wrong = 0;
+    for (size_t i = 0; i < N; i++) {
+        if (lo[i] == ref_lo[i] && hi[i] == ref_hi[i]) exact++;
+        else if (lo[i] <= ref_lo[i] && hi[i] >= ref_hi[i] && in[i] < INTERVAL_TINY) widened++;
+        else wrong++;
+    }
+    std::cout << "INTERVAL SQRT (" << N << " log-uniform inputs in [1e-300, 1e300] plus specials)\n";
+    std::cout << std::string(96, '-') << "\n";
+    std::cout << "  vs MXCSR directed rounding: " << exact << " identical, " << widened
+              << " tiny inputs widened by one ulp, " << wrong << " wrong\n\n";
+
+    struct Variant {
+        const char* name;
+        void (*run)(const double*, double*, double*, size_t);
+    };
+    const Variant variants[] = {
+        {"MXCSR switch per element", sqrt_interval_mxcsr},
+        {"MXCSR switch per pass", sqrt_interval_mxcsr_passes},
+        {"sqrt_interval scalar", sqrt_interval_scalar},
+        {"sqrt_interval batch", sqrt_interval},
+    };
+    const int ROUNDS = 21, REPS = 64;
+    std::vector<std::vector<double>> samples(4);
+    for (int r = 0; r < ROUNDS; r++) {
+        for (size_t v = 0; v < 4; v++) {
+            auto start = std::chrono::steady_clock::now();
+            for (int k = 0; k < REPS; k++) variants[v].run(in.data(), lo.data(), hi.data(), N);
+            samples[v].push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                                 (REPS * N));
+        }
+    }
+    std::cout << "  median ns per interval [95% CI], vs switching per element:\n";
+    for (size_t v = 0; v < 4; v++) {
+        SampleStats s = summarize(samples[v]);
+        std::cout << "  " << std::left << std::setw(26) << variants[v].name << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(8) << s.median << " ns [" << s.lo << ", " << s.hi << "]";
+        if (v) std::cout << "  " << describe_comparison(compare_samples(samples[0], samples[v]));
+        std::cout << "\n";
+    }
+}
+
+// ==================== FUSED REDUCTIONS ====================
+// Reductions over roots without an output array: sum_sqrt, sum_rsqrt,
+// max_sqrt/min_sqrt and argmax_sqrt/argmin_sqrt read the input once.
+//
+// Sums keep four vector accumulators so the adds overlap; SUM_COMPENSATED
+// adds a Neumaier (Kahan-Babuska) correction term per lane. The input is cut
+// into fixed 64K-element chunks reduced independently (on the pool if one is
+// given) and the chunk partials are combined in a fixed pairwise tree, so the
+// result is bit-identical for any thread count.
+//
+// sqrt is monotonic, so max/min compare the raw inputs and only the winner
+// is rooted. Negative and NaN inputs have no root and are skipped; if none
+// is left, max/min return NaN and argmax/argmin return n. Ties go to the
+// lowest index.
+
+enum Summation { SUM_FAST, SUM_COMPENSATED };
+
+struct SumPartial {
+    double sum, comp;
+};
+
+static inline SumPartial sum_combine(SumPartial a, SumPartial b) {
+    // two-sum: s + e == a.sum + b.sum exactly
+    double s = a.sum + b.sum;
+    double bb = s - a.sum;
+    double e = (a.sum - (s - bb)) + (b.sum - bb);
+    return SumPartial{s, a.comp + b.comp + e};
+}
+
+static SumPartial sum_tree(const SumPartial* p, size_t n, bool compensated) {
+    if (n == 1) return p[0];
+    SumPartial a = sum_tree(p, n / 2, compensated), b = sum_tree(p + n / 2, n - n / 2, compensated);
+    return compensated ? sum_combine(a, b) : SumPartial{a.sum + b.sum, 0};
+}
+
+static const size_t REDUCE_CHUNK = 1 << 16;
+
+#if defined(__AVX2__)
+// rsqrtps estimate + one Newton step in double, exact 1/sqrt outside the float normals
+static inline __m256d rsqrt_fast_pd(__m256d x) {
+    __m256d y = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(x)));
+    __m256d x_half = _mm256_mul_pd(_mm256_set1_pd(0.5), x);
+    y = _mm256_mul_pd(y, _mm256_sub_pd(_mm256_set1_pd(1.5), _mm256_mul_pd(x_half, _mm256_mul_pd(y, y))));
+    __m256d bad = _mm256_or_pd(_mm256_cmp_pd(x, _mm256_set1_pd(FLT_MIN), _CMP_NGE_UQ),
+                               _mm256_cmp_pd(x, _mm256_set1_pd(FLT_MAX), _CMP_GT_OQ));
+    if (!_mm256_testz_pd(bad, bad))
+        y = _mm256_blendv_pd(y, _mm256_div_pd(_mm256_set1_pd(1.0), _mm256_sqrt_pd(x)), bad);
+    return y;
+}
+
+template <int Tier, bool Reciprocal>
+static inline __m256d reduce_root_pd(__m256d x) {
+    if (Reciprocal && Tier == SQRT_FAST) return rsqrt_fast_pd(x);
+    __m256d r = Tier == SQRT_EXACT ? _mm256_sqrt_pd(x) : Tier == SQRT_OPTIMAL ? sqrt_optimal_pd(x) : sqrt_fast_pd(x);
+    return Reciprocal ? _mm256_div_pd(_mm256_set1_pd(1.0), r) : r;
+}
+
+template <bool Compensated>
+static inline void sum_add_pd(__m256d& s, __m256d& c, __m256d v) {
+    __m256d t = _mm256_add_pd(s, v);
+    if (Compensated) {
+        const __m256d sign = _mm256_set1_pd(-0.0);
+        __m256d s_bigger = _mm256_cmp_pd(_mm256_andnot_pd(sign, s), _mm256_andnot_pd(sign, v), _CMP_GE_OQ);
+        __m256d lost = _mm256_blendv_pd(_mm256_add_pd(_mm256_sub_pd(v, t), s),
+                                        _mm256_add_pd(_mm256_sub_pd(s, t), v), s_bigger);
+        c = _mm256_add_pd(c, lost);
+    }
+    s = t;
+}
+
+static inline __m256i tail_mask(size_t left) {
+    return _mm256_cmpgt_epi64(_mm256_set1_epi64x((long long)left), _mm256_set_epi64x(3, 2, 1, 0));
+}
+
+template <int Tier, bool Reciprocal, bool Compensated>
+static SumPartial sum_chunk(const double* in, size_t n) {
+    __m256d s[4], c[4];
+    for (int k = 0; k < 4; k++) s[k] = c[k] = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        for (int k = 0; k < 4; k++)
+            sum_add_pd<Compensated>(s[k], c[k], reduce_root_pd<Tier, Reciprocal>(_mm256_loadu_pd(in + i + 4 * k)));
+    for (; i + 4 <= n; i += 4) sum_add_pd<Compensated>(s[0], c[0], reduce_root_pd<Tier, Reciprocal>(_mm256_loadu_pd(in + i)));
+    if (i < n) {
+        // Pad with 1.0 so no lane computes 1/sqrt(0), then drop the padding
+        __m256i mask = tail_mask(n - i);
+        __m256d x = _mm256_blendv_pd(_mm256_set1_pd(1.0), _mm256_maskload_pd(in + i, mask), _mm256_castsi256_pd(mask));
+        __m256d v = _mm256_and_pd(reduce_root_pd<Tier, Reciprocal>(x), _mm256_castsi256_pd(mask));
+        sum_add_pd<Compensated>(s[1], c[1], v);
+    }
+    SumPartial lanes[16];
+    for (int k = 0; k < 4; k++) {
+        alignas(32) double sv[4], cv[4];
+        _mm256_store_pd(sv, s[k]);
+        _mm256_store_pd(cv, c[k]);
+        for (int l = 0; l < 4; l++) lanes[4 * k + l] = SumPartial{sv[l], cv[l]};
+    }
+    return sum_tree(lanes, 16, Compensated);
+}
+
+template <bool Reciprocal, bool Compensated>
+static SumPartial sum_chunk_tier(const double* in, size_t n, SqrtTier tier) {
+    switch (tier) {
+    case SQRT_EXACT:   return sum_chunk<SQRT_EXACT, Reciprocal, Compensated>(in, n);
+    case SQRT_OPTIMAL: return sum_chunk<SQRT_OPTIMAL, Reciprocal, Compensated>(in, n);
+    case SQRT_FAST:    return sum_chunk<SQRT_FAST, Reciprocal, Compensated>(in, n);
+    }
+    return SumPartial{0, 0};
+}
+#else
+// Roots a small stack buffer at a time with sqrt_batch, four scalar accumulators
+template <bool Reciprocal, bool Compensated>
+static SumPartial sum_chunk_tier(const double* in, size_t n, SqrtTier tier) {
+    SumPartial acc[4] = {};
+    double buf[256];
+    for (size_t i = 0; i < n; i += 256) {
+        size_t m = std::min<size_t>(256, n - i);
+        sqrt_batch(in + i, buf, m, tier);
+        for (size_t j = 0; j < m; j++) {
+            double v = Reciprocal ? 1 / buf[j] : buf[j];
+            SumPartial& a = acc[j % 4];
+            a = Compensated ? sum_combine(a, SumPartial{v, 0}) : SumPartial{a.sum + v, 0};
+        }
+    }
+    return sum_tree(acc, 4, Compensated);
+}
+#endif
+
+template <bool Reciprocal>
+static double sum_roots(const double* in, size_t n, SqrtTier tier, Summation mode, ThreadPool* pool) {
+    if (n == 0) return 0;
+    const size_t chunks = (n + REDUCE_CHUNK - 1) / REDUCE_CHUNK;
+    const bool compensated = mode == SUM_COMPENSATED;
+    std::vector<SumPartial> partial(chunks);
+    auto run = [&](size_t k) {
+        const double* p = in + k * REDUCE_CHUNK;
+        size_t m = std::min(REDUCE_CHUNK, n - k * REDUCE_CHUNK);
+        partial[k] = compensated ? sum_chunk_tier<Reciprocal, true>(p, m, tier)
+                                 : sum_chunk_tier<Reciprocal, false>(p, m, tier);
+    };
+    if (pool && chunks > 1) pool->parallel_for(chunks, run);
+    else for (size_t k = 0; k < chunks; k++) run(k);
+    SumPartial total = sum_tree(partial.data(), chunks, compensated);
+    return total.sum + total.comp;
+}
+
+// sum of sqrt(in[i])
+double sum_sqrt(const double* in, size_t n, SqrtTier tier = SQRT_EXACT, Summation mode = SUM_FAST,
+                ThreadPool* pool = nullptr) {
+    TraceScope span("sum_sqrt", n);
+    return sum_roots<false>(in, n, tier, mode, pool);
+}
+
+// sum of 1/sqrt(in[i])
+double sum_rsqrt(const double* in, size_t n, SqrtTier tier = SQRT_EXACT, Summation mode = SUM_FAST,
+                 ThreadPool* pool = nullptr) {
+    TraceScope span("sum_rsqrt", n);
+    return sum_roots<true>(in, n, tier, mode, pool);
+}
+
+struct ArgPartial {
+    double x;     // winning raw input
+    size_t index; // n if no input had a root
+};
+
+// Better value wins; equal values go to the lower index
+template <bool Max>
+static inline bool arg_better(const ArgPartial& a, const ArgPartial& b, size_t none) {
+    if (a.index == none) return false;
+    if (b.index == none) return true;
+    if (a.x != b.x) return Max ? a.x > b.x : a.x < b.x;
+    return a.index < b.index;
+}
+
+template <bool Max>
+static ArgPartial arg_chunk(const double* in, size_t begin, size_t end, size_t none) {
+    ArgPartial best{0, none};
+    size_t i = begin;
+#if defined(__AVX2__)
+    // Lanes start empty as NaN. The unordered NLE/NGE compares accept any
+    // valid input into an empty lane, +inf included, as the scalar tail does.
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d value[4], index[4];
+    for (int k = 0; k < 4; k++) {
+        value[k] = _mm256_set1_pd(NAN);
+        index[k] = _mm256_set1_pd(-1);
+    }
+    // Indices ride along as doubles (exact below 2^53)
+    __m256d at = _mm256_add_pd(_mm256_set1_pd((double)i), _mm256_set_pd(3, 2, 1, 0));
+    const __m256d step = _mm256_set1_pd(4);
+    for (; i + 16 <= end; i += 16) {
+        for (int k = 0; k < 4; k++) {
+            __m256d x = _mm256_loadu_pd(in + i + 4 * k);
+            __m256d better = _mm256_and_pd(_mm256_cmp_pd(x, zero, _CMP_GE_OQ),
+                                           _mm256_cmp_pd(x, value[k], Max ? _CMP_NLE_UQ : _CMP_NGE_UQ));
+            value[k] = _mm256_blendv_pd(value[k], x, better);
+            index[k] = _mm256_blendv_pd(index[k], at, better);
+            at = _mm256_add_pd(at, step);
+        }
+    }
+    for (int k = 0; k < 4; k++) {
+        alignas(32) double v[4], idx[4];
+        _mm256_store_pd(v, value[k]);
+        _mm256_store_pd(idx, index[k]);
+        for (int l = 0; l < 4; l++) {
+            ArgPartial lane{v[l], idx[l] < 0 ? none : (size_t)idx[l]};
+            if (arg_better<Max>(lane, best, none)) best = lane;
+        }
+    }
+#endif
+    for (; i < end; i++) {
+        ArgPartial cand{in[i], in[i] >= 0 ? i : none};
+        if (arg_better<Max>(cand, best, none)) best = cand;
+    }
+    return best;
+}
+
+template <bool Max>
+static ArgPartial arg_reduce(const double* in, size_t n, ThreadPool* pool) {
+    const size_t chunks = (n + REDUCE_CHUNK - 1) / REDUCE_CHUNK;
+    std::vector<ArgPartial> partial(chunks);
+    auto run = [&](size_t k) {
+        partial[k] = arg_chunk<Max>(in, k * REDUCE_CHUNK, std::min(n, (k + 1) * REDUCE_CHUNK), n);
+    };
+    if (pool && chunks > 1) pool->parallel_for(chunks, run);
+    else for (size_t k = 0; k < chunks; k++) run(k);
+    ArgPartial best{0, n};
+    for (const ArgPartial& p : partial) if (arg_better<Max>(p, best, n)) best = p;
+    return best;
+}
+
+size_t argmax_sqrt(const double* in, size_t n, ThreadPool* pool = nullptr) {
+    return arg_reduce<true>(in, n, pool).index;
+}
+
+size_t argmin_sqrt(const double* in, size_t n, ThreadPool* pool = nullptr) {
+    return arg_reduce<false>(in, n, pool).index;
+}
+
+double max_sqrt(const double* in, size_t n, ThreadPool* pool = nullptr) {
+    ArgPartial best = arg_reduce<true>(in, n, pool);
+    return best.index == n ? NAN : std::sqrt(best.x);
+}
+
+double min_sqrt(const double* in, size_t n, ThreadPool* pool = nullptr) {
+    ArgPartial best = arg_reduce<false>(in, n, pool);
+    return best.index == n ? NAN : std::sqrt(best.x);
+}
+
+void reduce_benchmark() {
+    const size_t N = 1 << 24;
+    std::vector<double> in(N), roots(N);
+    std::mt19937_64 rng(3);
+    std::uniform_real_distribution<double> exponent(-8, 8);
+    for (double& x : in) x = std::pow(10.0, exponent(rng));
+
+    long double reference = 0;
+    for (double x : in) reference += std::sqrt((long double)x);
+
+    std::cout << "FUSED REDUCTIONS (" << N << " log-uniform inputs in [1e-8, 1e8])\n";
+    std::cout << std::string(96, '-') << "\n";
+
+    // Determinism across thread counts
+    bool deterministic = true;
+    double single = sum_sqrt(in.data(), N, SQRT_EXACT, SUM_COMPENSATED);
+    for (unsigned threads : {2u, 3u, 8u}) {
+        ThreadPool pool(threads);
+        double s = sum_sqrt(in.data(), N, SQRT_EXACT, SUM_COMPENSATED, &pool);
+        deterministic = deterministic && std::memcmp(&s, &single, sizeof(s)) == 0;
+    }
+    std::cout << "  results for 1, 2, 3 and 8 threads " << (deterministic ? "bit-identical" : "DIFFER") << "\n";
+
+    double plain = sum_sqrt(in.data(), N), comp = sum_sqrt(in.data(), N, SQRT_EXACT, SUM_COMPENSATED);
+    double naive = 0;
+    for (double x : in) naive += std::sqrt(x);
+    std::cout << std::scientific << std::setprecision(2)
+              << "  relative error vs long double: sequential loop " << std::abs((double)((naive - reference) / reference))
+              << ", sum_sqrt " << std::abs((double)((plain - reference) / reference))
+              << ", compensated " << std::abs((double)((comp - reference) / reference)) << "\n\n";
+
+    auto time = [&](auto fn) {
+        std::vector<double> ms;
+        for (int r = 0; r < 7; r++) {
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        return median_of(ms);
+    };
+    volatile double sink;
+    double t_mat = time([&] {
+        sqrt_batch(in.data(), roots.data(), N);
+        double s = 0;
+        for (double r : roots) s += r;
+        sink = s;
+    });
+    double t_sum = time([&] { sink = sum_sqrt(in.data(), N); });
+    double t_comp = time([&] { sink = sum_sqrt(in.data(), N, SQRT_EXACT, SUM_COMPENSATED); });
+    double t_rsqrt = time([&] { sink = sum_rsqrt(in.data(), N, SQRT_FAST); });
+    double t_max_mat = time([&] {
+        sqrt_batch(in.data(), roots.data(), N);
+        sink = *std::max_element(roots.begin(), roots.end());
+    });
+    double t_max = time([&] { sink = max_sqrt(in.data(), N); });
+    double t_arg = time([&] { sink = (double)argmax_sqrt(in.data(), N); });
+    (void)sink;
+
+    std::cout << std::fixed << std::setprecision(2) << "  median ms:\n"
+              << "  sqrt_batch + sum loop     " << std::setw(8) << t_mat << "\n"
+              << "  sum_sqrt                  " << std::setw(8) << t_sum << "  (" << t_mat / t_sum << "x)\n"
+              << "  sum_sqrt compensated      " << std::setw(8) << t_comp << "  (" << t_mat / t_comp << "x)\n"
+              << "  sum_rsqrt fast            " << std::setw(8) << t_rsqrt << "\n"
+              << "  sqrt_batch + max_element  " << std::setw(8) << t_max_mat << "\n"
+              << "  max_sqrt                  " << std::setw(8) << t_max << "  (" << t_max_mat / t_max << "x)\n"
+              << "  argmax_sqrt               " << std::setw(8) << t_arg << "\n";
+}
+
+// ==================== DUAL-OUTPUT SQRT + RSQRT ====================
+// sqrt_rsqrt(x) -> {sqrt(x), 1/sqrt(x)} for code that normalizes and also
+// reports the norm. The rsqrt path already produces 1/sqrt(x) and gets the
+// root with one multiply, so the pair costs the same as either half:
+//   SQRT_EXACT    sqrt, then one division
+//   SQRT_OPTIMAL  rsqrt estimate + 2 Newton steps (~4e-14 double, ~1 ulp float)
+//   SQRT_FAST     rsqrt estimate + 1 Newton step (~2e-7)
+// Inputs inside the float normal range feed the estimate directly. Anything
+// else is taken apart: the estimate runs on the mantissa scaled into [1,4) and
+// the exponent is halved separately, so subnormals and huge doubles keep full
+// accuracy. Specials are patched in afterwards: +-0 -> {+-0, +-inf},
+// +inf -> {inf, 0}, negative or NaN -> {NaN, NaN}. The scalar form tests for
+// them with plain branches on that slow path; the packed forms blend.
+
+template <class T>
+struct RootPair {
+    T sqrt, rsqrt;
+};
+
+// 1/sqrt(m) for m in the float normal range
+template <class T>
+static inline T rsqrt_refined(T m, SqrtTier tier) {
+    T y = (T)_mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss((float)m)));
+    const T half_m = (T)0.5 * m;
+    for (int i = tier == SQRT_OPTIMAL ? 2 : 1; i > 0; i--) y = y * ((T)1.5 - half_m * y * y);
+    return y;
+}
+
+template <class T>
+inline RootPair<T> sqrt_rsqrt(T x, SqrtTier tier = SQRT_EXACT) {
+    typedef FloatBits<T> FB;
+    typedef typename FB::U U;
+    if (tier == SQRT_EXACT) {
+        T s = std::sqrt(x);
+        return RootPair<T>{s, 1 / s};
+    }
+    if (x >= (T)FLT_MIN && x <= (T)FLT_MAX) {
+        T r = rsqrt_refined(x, tier);
+        return RootPair<T>{x * r, r};
+    }
+    // Subnormals: scale by 2^(2P) first, undo with 2^P on the root
+    const int P = FB::MANT + 2;
+    const bool sub = std::abs(x) < std::numeric_limits<T>::min();
+    const T pre = sub ? from_bits<T>((U)(FB::BIAS + 2 * P) << FB::MANT) : (T)1;
+    const T post = sub ? from_bits<T>((U)(FB::BIAS + P) << FB::MANT) : (T)1;
+
+    // x = m * 4^k with m in [1,4): 1/sqrt(x) = 1/sqrt(m) * 2^-k
+    U bits = bits_of(x * pre);
+    U e = (bits >> FB::MANT) & FB::EXP_MAX, odd = (e & 1) ^ 1;
+    T m = from_bits<T>((bits & (((U)1 << FB::MANT) - 1)) | ((U)FB::BIAS + odd) << FB::MANT);
+    T scale = from_bits<T>(((3 * (U)FB::BIAS + odd - e) >> 1) << FB::MANT);
+
+    T r = rsqrt_refined(m, tier) * scale * post;
+    T s = x * r;
+
+    if (x == 0) { s = x; r = 1 / x; }
+    if (x == std::numeric_limits<T>::infinity()) { s = x; r = 0; }
+    if (!(x >= 0)) s = r = std::numeric_limits<T>::quiet_NaN();
+    return RootPair<T>{s, r};
+}
+
+#if defined(__AVX2__)
+// Packed forms of the above; the special-case selects become blends and the
+// reduction runs only for vectors with a lane outside the float range
+template <int Tier>
+static inline __m256d rsqrt_refined_pd(__m256d m) {
+    __m256d y = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(m)));
+    const __m256d half_m = _mm256_mul_pd(_mm256_set1_pd(0.5), m), three_half = _mm256_set1_pd(1.5);
+    for (int i = Tier == SQRT_OPTIMAL ? 2 : 1; i > 0; i--)
+        y = _mm256_mul_pd(y, _mm256_sub_pd(three_half, _mm256_mul_pd(half_m, _mm256_mul_pd(y, y))));
+    return y;
+}
+
+template <int Tier>
+static inline __m256 rsqrt_refined_ps(__m256 m) {
+    __m256 y = _mm256_rsqrt_ps(m);
+    const __m256 half_m = _mm256_mul_ps(_mm256_set1_ps(0.5f), m), three_half = _mm256_set1_ps(1.5f);
+    for (int i = Tier == SQRT_OPTIMAL ? 2 : 1; i > 0; i--)
+        y = _mm256_mul_ps(y, _mm256_sub_ps(three_half, _mm256_mul_ps(half_m, _mm256_mul_ps(y, y))));
+    return y;
+}
+
+template <int Tier>
+static inline void sqrt_rsqrt_pd(__m256d x, __m256d* s_out, __m256d* r_out) {
+    if (Tier == SQRT_EXACT) {
+        *s_out = _mm256_sqrt_pd(x);
+        *r_out = _mm256_div_pd(_mm256_set1_pd(1.0), *s_out);
+        return;
+    }
+    __m256d in_range = _mm256_and_pd(_mm256_cmp_pd(x, _mm256_set1_pd(FLT_MIN), _CMP_GE_OQ),
+                                     _mm256_cmp_pd(x, _mm256_set1_pd(FLT_MAX), _CMP_LE_OQ));
+    if (_mm256_movemask_pd(in_range) == 0xf) {
+        *r_out = rsqrt_refined_pd<Tier>(x);
+        *s_out = _mm256_mul_pd(x, *r_out);
+        return;
+    }
+    const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0);
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d sub = _mm256_cmp_pd(_mm256_andnot_pd(sign, x), _mm256_set1_pd(DBL_MIN), _CMP_LT_OQ);
+    __m256d pre = _mm256_blendv_pd(one, _mm256_set1_pd(0x1p108), sub);
+    __m256d post = _mm256_blendv_pd(one, _mm256_set1_pd(0x1p54), sub);
+
+    __m256i bits = _mm256_castpd_si256(_mm256_mul_pd(x, pre));
+    __m256i e = _mm256_and_si256(_mm256_srli_epi64(bits, 52), _mm256_set1_epi64x(0x7ff));
+    __m256i odd = _mm256_andnot_si256(e, _mm256_set1_epi64x(1));
+    __m256d m = _mm256_castsi256_pd(
+        _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x((1LL << 52) - 1)),
+                        _mm256_slli_epi64(_mm256_add_epi64(_mm256_set1_epi64x(1023), odd), 52)));
+    __m256i scale_e = _mm256_srli_epi64(_mm256_sub_epi64(_mm256_add_epi64(_mm256_set1_epi64x(3 * 1023), odd), e), 1);
+    __m256d scale = _mm256_castsi256_pd(_mm256_slli_epi64(scale_e, 52));
+
+    __m256d r = _mm256_mul_pd(_mm256_mul_pd(rsqrt_refined_pd<Tier>(m), scale), post);
+    __m256d s = _mm256_mul_pd(x, r);
+
+    __m256d is_zero = _mm256_cmp_pd(x, zero, _CMP_EQ_OQ);
+    s = _mm256_blendv_pd(s, x, is_zero);
+    r = _mm256_blendv_pd(r, _mm256_or_pd(_mm256_and_pd(sign, x), _mm256_set1_pd(INFINITY)), is_zero);
+    __m256d is_inf = _mm256_cmp_pd(x, _mm256_set1_pd(INFINITY), _CMP_EQ_OQ);
+    s = _mm256_blendv_pd(s, x, is_inf);
+    r = _mm256_andnot_pd(is_inf, r);
+    __m256d no_root = _mm256_cmp_pd(x, zero, _CMP_NGE_UQ);
+    *s_out = _mm256_blendv_pd(s, _mm256_set1_pd(NAN), no_root);
+    *r_out = _mm256_blendv_pd(r, _mm256_set1_pd(NAN), no_root);
+}
+
+template <int Tier>
+static inline void sqrt_rsqrt_ps(__m256 x, __m256* s_out, __m256* r_out) {
+    if (Tier == SQRT_EXACT) {
+        *s_out = _mm256_sqrt_ps(x);
+        *r_out = _mm256_div_ps(_mm256_set1_ps(1.0f), *s_out);
+        return;
+    }
+    __m256 in_range = _mm256_and_ps(_mm256_cmp_ps(x, _mm256_set1_ps(FLT_MIN), _CMP_GE_OQ),
+                                    _mm256_cmp_ps(x, _mm256_set1_ps(FLT_MAX), _CMP_LE_OQ));
+    if (_mm256_movemask_ps(in_range) == 0xff) {
+        *r_out = rsqrt_refined_ps<Tier>(x);
+        *s_out = _mm256_mul_ps(x, *r_out);
+        return;
+    }
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 sub = _mm256_cmp_ps(_mm256_andnot_ps(sign, x), _mm256_set1_ps(FLT_MIN), _CMP_LT_OQ);
+    __m256 pre = _mm256_blendv_ps(one, _mm256_set1_ps(0x1p50f), sub);
+    __m256 post = _mm256_blendv_ps(one, _mm256_set1_ps(0x1p25f), sub);
+
+    __m256i bits = _mm256_castps_si256(_mm256_mul_ps(x, pre));
+    __m256i e = _mm256_and_si256(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(0xff));
+    __m256i odd = _mm256_andnot_si256(e, _mm256_set1_epi32(1));
+    __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32((1 << 23) - 1)),
+                                                   _mm256_slli_epi32(_mm256_add_epi32(_mm256_set1_epi32(127), odd), 23)));
+    __m256i scale_e = _mm256_srli_epi32(_mm256_sub_epi32(_mm256_add_epi32(_mm256_set1_epi32(3 * 127), odd), e), 1);
+    __m256 scale = _mm256_castsi256_ps(_mm256_slli_epi32(scale_e, 23));
+
+    __m256 r = _mm256_mul_ps(_mm256_mul_ps(rsqrt_refined_ps<Tier>(m), scale), post);
+    __m256 s = _mm256_mul_ps(x, r);
+
+    __m256 is_zero = _mm256_cmp_ps(x, zero, _CMP_EQ_OQ);
+    s = _mm256_blendv_ps(s, x, is_zero);
+    r = _mm256_blendv_ps(r, _mm256_or_ps(_mm256_and_ps(sign, x), _mm256_set1_ps(INFINITY)), is_zero);
+    __m256 is_inf = _mm256_cmp_ps(x, _mm256_set1_ps(INFINITY), _CMP_EQ_OQ);
+    s = _mm256_blendv_ps(s, x, is_inf);
+    r = _mm256_andnot_ps(is_inf, r);
+    __m256 no_root = _mm256_cmp_ps(x, zero, _CMP_NGE_UQ);
+    *s_out = _mm256_blendv_ps(s, _mm256_set1_ps(NAN), no_root);
+    *r_out = _mm256_blendv_ps(r, _mm256_set1_ps(NAN), no_root);
+}
+
+template <int Tier>
+static void sqrt_rsqrt_batch_pd(const double* in, double* s, double* r, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d vs, vr;
+        sqrt_rsqrt_pd<Tier>(_mm256_loadu_pd(in + i), &vs, &vr);
+        _mm256_storeu_pd(s + i, vs);
+        _mm256_storeu_pd(r + i, vr);
+    }
+    if (i < n) {
+        alignas(32) double tmp[4] = {1.0, 1.0, 1.0, 1.0}, ts[4], tr[4];
+        std::memcpy(tmp, in + i, (n - i) * sizeof(double));
+        __m256d vs, vr;
+        sqrt_rsqrt_pd<Tier>(_mm256_load_pd(tmp), &vs, &vr);
+        _mm256_store_pd(ts, vs);
+        _mm256_store_pd(tr, vr);
+        std::memcpy(s + i, ts, (n - i) * sizeof(double));
+        std::memcpy(r + i, tr, (n - i) * sizeof(double));
+    }
+}
+
+template <int Tier>
+static void sqrt_rsqrt_batch_ps(const float* in, float* s, float* r, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 vs, vr;
+        sqrt_rsqrt_ps<Tier>(_mm256_loadu_ps(in + i), &vs, &vr);
+        _mm256_storeu_ps(s + i, vs);
+        _mm256_storeu_ps(r + i, vr);
+    }
+    if (i < n) {
+        alignas(32) float tmp[8] = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f}, ts[8], tr[8];
+        std::memcpy(tmp, in + i, (n - i) * sizeof(float));
+        __m256 vs, vr;
+        sqrt_rsqrt_ps<Tier>(_mm256_load_ps(tmp), &vs, &vr);
+        _mm256_store_ps(ts, vs);
+        _mm256_store_ps(tr, vr);
+        std::memcpy(s + i, ts, (n - i) * sizeof(float));
+        std::memcpy(r + i, tr, (n - i) * sizeof(float));
+    }
+}
+#endif
+
+// s[i] = sqrt(in[i]), r[i] = 1/sqrt(in[i]); in may alias s or r
+void sqrt_rsqrt_batch(const double* in, double* s, double* r, size_t n, SqrtTier tier = SQRT_EXACT) {
+    TraceScope span("sqrt_rsqrt_batch(f64)", n);
+#if defined(__AVX2__)
+    switch (tier) {
+    case SQRT_EXACT:   sqrt_rsqrt_batch_pd<SQRT_EXACT>(in, s, r, n); break;
+    case SQRT_OPTIMAL: sqrt_rsqrt_batch_pd<SQRT_OPTIMAL>(in, s, r, n); break;
+    case SQRT_FAST:    sqrt_rsqrt_batch_pd<SQRT_FAST>(in, s, r, n); break;
+    }
+#else
+    for (size_t i = 0; i < n; i++) {
+        RootPair<double> p = sqrt_rsqrt(in[i], tier);
+        s[i] = p.sqrt;
+        r[i] = p.rsqrt;
+    }
+#endif
+}
+
+void sqrt_rsqrt_batch(const float* in, float* s, float* r, size_t n, SqrtTier tier = SQRT_EXACT) {
+    TraceScope span("sqrt_rsqrt_batch(f32)", n);
+#if defined(__AVX2__)
+    switch (tier) {
+    case SQRT_EXACT:   sqrt_rsqrt_batch_ps<SQRT_EXACT>(in, s, r, n); break;
+    case SQRT_OPTIMAL: sqrt_rsqrt_batch_ps<SQRT_OPTIMAL>(in, s, r, n); break;
+    case SQRT_FAST:    sqrt_rsqrt_batch_ps<SQRT_FAST>(in, s, r, n); break;
+    }
+#else
+    for (size_t i = 0; i < n; i++) {
+        RootPair<float> p = sqrt_rsqrt(in[i], tier);
+        s[i] = p.sqrt;
+        r[i] = p.rsqrt;
+    }
+#endif
+}
+
+void dual_benchmark() {
+    const size_t N = 1 << 16;
+    std::vector<double> in(N), s(N), r(N);
+    std::vector<float> inf32(N), sf(N), rf(N);
+    std::mt19937_64 rng(17);
+    std::uniform_real_distribution<double> exponent(-300, 300);
+    for (size_t i = 0; i < N; i++) {
+        in[i] = std::pow(10.0, exponent(rng));
+        inf32[i] = (float)std::pow(10.0, exponent(rng) / 8.2);
+    }
+    in[0] = 5e-320;  // subnormal
+    inf32[0] = 1e-42f;
+
+    std::cout << "DUAL-OUTPUT SQRT + RSQRT (" << N << " log-uniform inputs, subnormals included)\n";
+    std::cout << std::string(96, '-') << "\n";
+    std::cout << "  tier      max rel err f64 (sqrt, rsqrt)    max rel err f32 (sqrt, rsqrt)\n";
+    for (SqrtTier tier : {SQRT_EXACT, SQRT_OPTIMAL, SQRT_FAST}) {
+        sqrt_rsqrt_batch(in.data(), s.data(), r.data(), N, tier);
+        sqrt_rsqrt_batch(inf32.data(), sf.data(), rf.data(), N, tier);
+        double es = 0, er = 0, fs = 0, fr = 0;
+        for (size_t i = 0; i < N; i++) {
+            long double root = std::sqrt((long double)in[i]), froot = std::sqrt((long double)inf32[i]);
+            es = std::max(es, (double)std::abs((s[i] - root) / root));
+            er = std::max(er, (double)std::abs((r[i] * root - 1)));
+            fs = std::max(fs, (double)std::abs((sf[i] - froot) / froot));
+            fr = std::max(fr, (double)std::abs((rf[i] * froot - 1)));
+        }
+        std::cout << "  " << std::left << std::setw(8) << tier_name(tier) << std::right << std::scientific
+                  << std::setprecision(2) << std::setw(12) << es << std::setw(11) << er << std::setw(22) << fs
+                  << std::setw(11) << fr << "\n";
+    }
+
+    // Throughput against the two-step alternative, on L1-resident slices so
+    // the arithmetic is timed rather than memory
+    const size_t L1 = 1024;
+    std::vector<double> near(L1);
+    for (size_t i = 0; i < L1; i++) near[i] = std::pow(10.0, exponent(rng) / 10);
+    auto time = [&](auto fn) {
+        std::vector<double> ns;
+        for (int k = 0; k < 15; k++) {
+            auto start = std::chrono::steady_clock::now();
+            for (int rep = 0; rep < 1024; rep++) fn();
+            ns.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                         (1024.0 * L1));
+        }
+        return median_of(ns);
+    };
+    double base_near = 0, base_wide = 0;
+    auto both = [&](const std::string& name, auto fn) {
+        double t_near = time([&] { fn(near.data()); }), t_wide = time([&] { fn(in.data()); });
+        std::cout << "  " << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(8) << t_near << std::setw(14) << t_wide;
+        if (base_near > 0)
+            std::cout << std::setprecision(2) << "   (" << base_near / t_near << "x, " << base_wide / t_wide << "x)";
+        std::cout << "\n";
+        if (base_near == 0) base_near = t_near, base_wide = t_wide;
+    };
+    std::cout << "\n  median ns/element, f64      1e-30..1e30   1e-300..1e300   vs sqrt + divide\n";
+    both("sqrt_batch + divide", [&](const double* x) {
+        sqrt_batch(x, s.data(), L1);
+        for (size_t i = 0; i < L1; i++) r[i] = 1 / s[i];
+    });
+    for (SqrtTier tier : {SQRT_EXACT, SQRT_OPTIMAL, SQRT_FAST})
+        both(std::string("sqrt_rsqrt_batch ") + tier_name(tier),
+             [&](const double* x) { sqrt_rsqrt_batch(x, s.data(), r.data(), L1, tier); });
+    both("sqrt_rsqrt scalar optimal", [&](const double* x) {
+        for (size_t i = 0; i < L1; i++) {
+            double v = x[i];
+            SCALAR_BARRIER(v);
+            RootPair<double> p = sqrt_rsqrt(v, SQRT_OPTIMAL);
+            s[i] = p.sqrt;
+            r[i] = p.rsqrt;
+        }
+    });
+}
+
+// ==================== HIGHER-ORDER RSQRT ITERATIONS ====================
+// With y ~ 1/sqrt(x) and residual e = 1 - x*y^2, the exact answer is
+// y * (1 - e)^-1/2 = y * (1 + e/2 + 3e^2/8 + 5e^3/16 + ...). Keeping the
+// terms through e^(Order-1) gives an iteration of that order:
+//   Order 2  Newton        y += y*e * 1/2                 4 steps
+//   Order 3  Halley        y += y*e * (1/2 + 3e/8)        3 steps
+//   Order 4  Householder   y += y*e * (1/2 + 3e/8 + 5e^2/16)  2 steps
+// From the 3.4% bit-hack seed each column reaches double precision in the
+// step count shown. A step costs the residual (mul + FMA), one FMA per
+// polynomial term past the first and the final FMA, with y*e running beside
+// the polynomial: 3 latencies for Newton (the 1/2 folds into the residual),
+// 4 for Halley, 5 for Householder, so the chains are 12, 12 and 10 long:
+// Halley ties Newton and only the order-4 step shortens the path. Normal positive finite
+// inputs only; anything else goes to the hardware root.
+
+constexpr int householder_steps(int order) { return order == 2 ? 4 : order == 3 ? 3 : 2; }
+
+template <int Order>
+static inline double rsqrt_householder_step(double x, double y) {
+    // Newton folds the 1/2 into the residual: one FMA shorter per step
+    if (Order == 2) return mul_add<RANGE_FMA>(y, neg_mul_add<RANGE_FMA>(0.5 * x * y, y, 0.5), y);
+    double e = neg_mul_add<RANGE_FMA>(x * y, y, 1.0);
+    double p = Order == 3 ? mul_add<RANGE_FMA>(e, 0.375, 0.5)
+                          : mul_add<RANGE_FMA>(mul_add<RANGE_FMA>(e, 0.3125, 0.375), e, 0.5);
+    return mul_add<RANGE_FMA>(y * e, p, y);
+}
+
+template <int Order>
+inline double rsqrt_householder(double x) {
+    if (!(x >= DBL_MIN && x <= DBL_MAX)) return 1 / std::sqrt(x);
+    double y = from_bits<double>(0x5fe6eb50c7b537a9ull - (bits_of(x) >> 1));
+    for (int i = 0; i < householder_steps(Order); i++) y = rsqrt_householder_step<Order>(x, y);
+    return y;
+}
+
+template <int Order>
+inline double sqrt_householder(double x) {
+    if (!(x >= DBL_MIN && x <= DBL_MAX)) return std::sqrt(x);
+    return x * rsqrt_householder<Order>(x);
+}
+
+#if defined(__AVX2__) && defined(__FMA__)
+template <int Order>
+static inline __m256d rsqrt_householder_step_pd(__m256d x, __m256d y) {
+    if (Order == 2) {
+        __m256d hx = _mm256_mul_pd(_mm256_set1_pd(0.5), x);
+        return _mm256_fmadd_pd(y, _mm256_fnmadd_pd(_mm256_mul_pd(hx, y), y, _mm256_set1_pd(0.5)), y);
+    }
+    __m256d e = _mm256_fnmadd_pd(_mm256_mul_pd(x, y), y, _mm256_set1_pd(1.0));
+    __m256d p = _mm256_set1_pd(0.5);
+    if (Order == 3) p = _mm256_fmadd_pd(e, _mm256_set1_pd(0.375), p);
+    if (Order == 4)
+        p = _mm256_fmadd_pd(_mm256_fmadd_pd(e, _mm256_set1_pd(0.3125), _mm256_set1_pd(0.375)), e, p);
+    return _mm256_fmadd_pd(_mm256_mul_pd(y, e), p, y);
+}
+
+template <int Order>
+static inline __m256d rsqrt_householder_pd(__m256d x) {
+    __m256i seed = _mm256_sub_epi64(_mm256_set1_epi64x(0x5fe6eb50c7b537a9ll),
+                                    _mm256_srli_epi64(_mm256_castpd_si256(x), 1));
+    __m256d y = _mm256_castsi256_pd(seed);
+    for (int i = 0; i < householder_steps(Order); i++) y = rsqrt_householder_step_pd<Order>(x, y);
+
+    __m256d bad = _mm256_or_pd(_mm256_cmp_pd(x, _mm256_set1_pd(DBL_MIN), _CMP_NGE_UQ),
+                               _mm256_cmp_pd(x, _mm256_set1_pd(DBL_MAX), _CMP_GT_OQ));
+    if (!_mm256_testz_pd(bad, bad))
+        y = _mm256_blendv_pd(y, _mm256_div_pd(_mm256_set1_pd(1.0), _mm256_sqrt_pd(x)), bad);
+    return y;
+}
+
+template <int Order>
+static inline __m256d sqrt_householder_pd(__m256d x) {
+    __m256d result = _mm256_mul_pd(x, rsqrt_householder_pd<Order>(x));
+    __m256d bad = _mm256_or_pd(_mm256_cmp_pd(x, _mm256_set1_pd(DBL_MIN), _CMP_NGE_UQ),
+                               _mm256_cmp_pd(x, _mm256_set1_pd(DBL_MAX), _CMP_GT_OQ));
+    if (!_mm256_testz_pd(bad, bad)) result = _mm256_blendv_pd(result, _mm256_sqrt_pd(x), bad);
+    return result;
+}
+#endif
+
+// Latency mode as in multi_benchmark: each input waits on the previous root
+template <double (*Fn)(double)>
+static double chain_latency_loop(const float* data, size_t size, int iterations, const void*) {
+    double r = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int it = 0; it < iterations; it++) r = Fn(data[it % size] + r * 0.0);
+    auto end = std::chrono::high_resolution_clock::now();
+    volatile double sink = r;
+    (void)sink;
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+#if defined(__AVX2__) && defined(__FMA__)
+template <__m256d (*Fn)(__m256d)>
+static double chain_latency_loop_pd(const float* data, size_t size, int iterations, const void*) {
+    __m256d r = _mm256_setzero_pd();
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int it = 0; it < iterations; it++) {
+        __m256d x = _mm256_set1_pd(data[it % size]);
+        r = Fn(_mm256_fmadd_pd(r, _mm256_setzero_pd(), x));
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    volatile double sink = _mm256_cvtsd_f64(r);
+    (void)sink;
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+#endif
+
+static double std_sqrt_d(double x) { return std::sqrt(x); }
+
+// Two Newton steps (sqrt_optimal) are the baseline: that is what the scalar
+// kernels run today. They stop short of double precision, so the accuracy
+// table lists them next to the higher-order kernels, and the latency table
+// also compares against four Newton steps, which do reach it.
+void householder_benchmark() {
+    // Accuracy against the correctly rounded root over many binades
+    const size_t N = 1 << 20;
+    std::mt19937_64 rng(93);
+    std::uniform_real_distribution<double> exponent(-300, 300), mantissa(1, 10);
+    double worst_ulp[4] = {0, 0, 0, 0}, worst_rel[3] = {0, 0, 0};
+    for (size_t i = 0; i < N; i++) {
+        double x = mantissa(rng) * std::pow(10.0, std::floor(exponent(rng)));
+        double ref = std::sqrt(x);
+        long double rref = 1 / std::sqrt((long double)x);
+        double s[4] = {sqrt_optimal(x), sqrt_householder<2>(x), sqrt_householder<3>(x), sqrt_householder<4>(x)};
+        double r[3] = {rsqrt_householder<2>(x), rsqrt_householder<3>(x), rsqrt_householder<4>(x)};
+        for (int k = 0; k < 4; k++)
+            worst_ulp[k] = std::max(worst_ulp[k], std::abs(s[k] - ref) / (std::nextafter(ref, INFINITY) - ref));
+        for (int k = 0; k < 3; k++) worst_rel[k] = std::max(worst_rel[k], (double)std::abs(r[k] / rref - 1));
+    }
+    std::cout << "HIGHER-ORDER RSQRT ITERATIONS (bit-hack seed, " << N << " inputs over 1e-300..1e300)\n";
+    std::cout << std::string(96, '-') << "\n";
+    const char* names[4] = {"Newton x2", "Newton x4", "Halley x3", "Householder x2"};
+    for (int k = 0; k < 4; k++) {
+        std::cout << "  " << std::left << std::setw(16) << names[k] << std::right << "sqrt max " << std::fixed
+                  << std::setprecision(2) << worst_ulp[k] << " ulp";
+        if (k == 0) std::cout << "  (sqrt_optimal)";
+        else std::cout << ",  rsqrt max rel err " << std::scientific << worst_rel[k - 1];
+        std::cout << "\n";
+    }
+
+    std::vector<float> data;
+    for (int i = 0; i < 8; i++) data.push_back(0.37f + 1.9f * (float)i);
+    const SpeedKernel kernels[] = {
+        {"sqrt_optimal (Newton x2)", chain_latency_loop<sqrt_optimal>},
+        {"sqrt_householder<2>", chain_latency_loop<sqrt_householder<2>>},
+        {"sqrt_householder<3>", chain_latency_loop<sqrt_householder<3>>},
+        {"sqrt_householder<4>", chain_latency_loop<sqrt_householder<4>>},
+        {"std::sqrt", chain_latency_loop<std_sqrt_d>},
+#if defined(__AVX2__) && defined(__FMA__)
+        {"sqrt_optimal_pd (Newton x2)", chain_latency_loop_pd<sqrt_optimal_pd<>>},
+        {"sqrt_householder_pd<2>", chain_latency_loop_pd<sqrt_householder_pd<2>>},
+        {"sqrt_householder_pd<3>", chain_latency_loop_pd<sqrt_householder_pd<3>>},
+        {"sqrt_householder_pd<4>", chain_latency_loop_pd<sqrt_householder_pd<4>>},
+#endif
+    };
+    const size_t KERNELS = sizeof(kernels) / sizeof(kernels[0]);
+    std::vector<std::vector<double>> samples = measure_interleaved(kernels, KERNELS, data.data(), data.size(), 200000, 21);
+
+    std::cout << "\n  Latency (dependent calls, median ns per call [95% CI]), vs two Newton steps; "
+                 "[vs four Newton steps]:\n";
+    for (size_t k = 0; k < KERNELS; k++) {
+        SampleStats s = summarize(samples[k]);
+        size_t base = k < 5 ? 0 : 5, four = base + 1;
+        std::cout << "  " << std::left << std::setw(28) << kernels[k].name << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(8) << s.median << " ns [" << s.lo << ", " << s.hi << "]";
+        if (k != base) std::cout << "  " << describe_comparison(compare_samples(samples[base], samples[k]));
+        if (k > four && k < base + 4) std::cout << "  [" << describe_comparison(compare_samples(samples[four], samples[k])) << "]";
+        std::cout << "\n";
+    }
+}
+
+// ==================== ROLLING CORRELATION ====================
+// RollingCorrelation keeps sliding-window sums for N instruments: S_i = sum x_i
+// and C_ij = sum x_i x_j over the last `window` observations. update() adds
+// the new rows, subtracts the ones leaving the window, and refreshes
+//   corr_ij = (C_ij - S_i S_j / n) * r_i * r_j,   r_i = 1/sqrt(C_ii - S_i^2 / n)
+// so the N^2 entries cost two multiplies each on top of N rsqrt values from
+// sqrt_rsqrt_batch. The (n - 1) normalization cancels.
+//
+// C is walked in 64x64 tiles of its upper triangle; each tile takes all
+// pending rows (rank-2k update) and writes both halves of the output while it
+// is in cache. A ThreadPool spreads row blocks over threads, largest first.
+// Zero-variance instruments give NaN rows. The sums are updated by add and
+// subtract, so rounding drift grows slowly with the number of updates;
+// resync() rebuilds them from the window.
+
+class RollingCorrelation {
+public:
+    static const size_t BLOCK = 64;
+
+    RollingCorrelation(size_t instruments, size_t window, SqrtTier tier = SQRT_EXACT)
+        : n(instruments), window(window), tier(tier), ring(alloc(window * n)), cross(alloc(n * n)),
+          corr(alloc(n * n)), sum(n), diag(n), mean(n), rs(n), scratch(n), evicted(window * n) {
+        std::memset(cross.get(), 0, n * n * sizeof(double));
+        std::memset(corr.get(), 0, n * n * sizeof(double));
+    }
+
+    size_t instruments() const { return n; }
+    size_t observations() const { return filled; }
+
+    // Row-major n x n; valid after the first update with two or more observations
+    const double* correlation() const { return corr.get(); }
+
+    // Appends count observations (row-major, count x n) and refreshes correlation()
+    void update(const double* rows, size_t count = 1, ThreadPool* pool = nullptr) {
+        while (count > 0) {
+            size_t k = std::min(count, window);
+            push(rows, k, count == k, pool);
+            rows += k * n;
+            count -= k;
+        }
+    }
+
+    // Recomputes the sums from the observations in the window
+    void resync(ThreadPool* pool = nullptr) {
+        std::fill(sum.begin(), sum.end(), 0.0);
+        std::fill(diag.begin(), diag.end(), 0.0);
+        for (size_t t = 0; t < filled; t++) accumulate_diag(ring.get() + slot(pushed - filled + t) * n, 1.0);
+        prepare_outputs();
+        // Ring rows sit in slot order; the sums don't depend on it
+        run_tiles(filled == window ? ring.get() : ring.get() + slot(pushed - filled) * n, filled, nullptr, 0,
+                  true, true, pool);
+    }
+
+private:
+    struct FreeDeleter {
+        void operator()(double* p) const { std::free(p); }
+    };
+
+    static double* alloc(size_t count) {
+        return (double*)std::aligned_alloc(64, (std::max<size_t>(count, 1) * sizeof(double) + 63) / 64 * 64);
+    }
+
+    size_t slot(size_t observation) const { return observation % window; }
+
+    void push(const double* rows, size_t k, bool emit, ThreadPool* pool) {
+        TraceScope span("correlation update", k);
+        size_t leaving = filled + k > window ? filled + k - window : 0;
+        for (size_t t = 0; t < leaving; t++) {
+            const double* old = ring.get() + slot(pushed - filled + t) * n;
+            std::memcpy(evicted.data() + t * n, old, n * sizeof(double));
+            accumulate_diag(old, -1.0);
+        }
+        for (size_t t = 0; t < k; t++) {
+            std::memcpy(ring.get() + slot(pushed + t) * n, rows + t * n, n * sizeof(double));
+            accumulate_diag(rows + t * n, 1.0);
+        }
+        pushed += k;
+        filled = std::min(window, filled + k);
+        if (emit) prepare_outputs();
+        run_tiles(rows, k, evicted.data(), leaving, emit, false, pool);
+    }
+
+    void accumulate_diag(const double* row, double sign) {
+        for (size_t i = 0; i < n; i++) {
+            sum[i] += sign * row[i];
+            diag[i] += sign * row[i] * row[i];
+        }
+    }
+
+    // A variance within rounding noise of the sums counts as zero and gets a
+    // NaN rsqrt, which then propagates through the row and column
+    void prepare_outputs() {
+        const double count = (double)filled, noise = 8 * count * DBL_EPSILON;
+        for (size_t i = 0; i < n; i++) {
+            mean[i] = sum[i] / count;
+            double var = diag[i] - sum[i] * mean[i];
+            scratch[i] = var > noise * diag[i] ? var : NAN;
+        }
+        sqrt_rsqrt_batch(scratch.data(), scratch.data(), rs.data(), n, tier);
+    }
+
+    void run_tiles(const double* add, size_t k_add, const double* sub, size_t k_sub, bool emit, bool reset,
+                   ThreadPool* pool) {
+        const size_t blocks = (n + BLOCK - 1) / BLOCK;
+        auto row_block = [&](size_t bi) {
+            for (size_t bj = bi; bj < blocks; bj++) tile(bi, bj, add, k_add, sub, k_sub, emit, reset);
+        };
+        if (pool) pool->parallel_for(blocks, row_block);
+        else for (size_t bi = 0; bi < blocks; bi++) row_block(bi);
+    }
+
+    void tile(size_t bi, size_t bj, const double* add, size_t k_add, const double* sub, size_t k_sub, bool emit,
+              bool reset) {
+        const size_t i0 = bi * BLOCK, i1 = std::min(n, i0 + BLOCK);
+        const size_t j1 = std::min(n, bj * BLOCK + BLOCK);
+        double* out = corr.get();
+        for (size_t i = i0; i < i1; i++) {
+            const size_t j0 = bi == bj ? i + 1 : bj * BLOCK;
+            double* c = cross.get() + i * n;
+            if (reset) std::fill(c + j0, c + j1, 0.0);
+            for (size_t t = 0; t < k_add; t++) {
+                const double a = add[t * n + i], *row = add + t * n;
+                for (size_t j = j0; j < j1; j++) c[j] += a * row[j];
+            }
+            for (size_t t = 0; t < k_sub; t++) {
+                const double b = sub[t * n + i], *row = sub + t * n;
+                for (size_t j = j0; j < j1; j++) c[j] -= b * row[j];
+            }
+            if (!emit) continue;
+            const double s = sum[i], r = rs[i];
+            for (size_t j = j0; j < j1; j++) out[i * n + j] = (c[j] - s * mean[j]) * (r * rs[j]);
+            for (size_t j = j0; j < j1; j++) out[j * n + i] = out[i * n + j];
+            if (bi == bj) out[i * n + i] = r * 0 + 1;  // NaN for zero variance
+        }
+    }
+
+    size_t n, window;
+    SqrtTier tier;
+    size_t pushed = 0, filled = 0;
+    std::unique_ptr<double[], FreeDeleter> ring, cross, corr;
+    std::vector<double> sum, diag, mean, rs, scratch, evicted;
+};
+
+// Engine vs the direct form: full C updated row by row, then
+// cov / sqrt(var_i * var_j) with a square root and division per entry
+void correlation_benchmark() {
+    const size_t N = 2000, W = 250, UPDATES = 10;
+    std::mt19937_64 rng(94);
+    std::normal_distribution<double> noise(0.0, 0.01);
+    std::vector<double> stream((W + UPDATES) * N);
+    for (size_t t = 0; t < W + UPDATES; t++) {
+        double market = noise(rng);
+        for (size_t i = 0; i < N; i++) stream[t * N + i] = (0.2 + 0.6 * (double)i / N) * market + noise(rng);
+    }
+
+    std::cout << "ROLLING CORRELATION (" << N << " instruments, window " << W << ", median ms per update)\n";
+    std::cout << std::string(96, '-') << "\n";
+    typedef std::chrono::high_resolution_clock clock;
+    auto ms_since = [](clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    };
+
+    std::vector<double> c(N * N, 0.0), s(N, 0.0), naive(N * N);
+    for (size_t t = 0; t < W; t++)
+        for (size_t i = 0; i < N; i++) {
+            s[i] += stream[t * N + i];
+            for (size_t j = 0; j < N; j++) c[i * N + j] += stream[t * N + i] * stream[t * N + j];
+        }
+    std::vector<double> times;
+    for (size_t u = 0; u < UPDATES; u++) {
+        const double *add = &stream[(W + u) * N], *sub = &stream[u * N];
+        auto start = clock::now();
+        for (size_t i = 0; i < N; i++) {
+            s[i] += add[i] - sub[i];
+            for (size_t j = 0; j < N; j++) c[i * N + j] += add[i] * add[j] - sub[i] * sub[j];
+        }
+        for (size_t i = 0; i < N; i++)
+            for (size_t j = 0; j < N; j++) {
+                double cov = c[i * N + j] - s[i] * s[j] / W;
+                double vi = c[i * N + i] - s[i] * s[i] / W, vj = c[j * N + j] - s[j] * s[j] / W;
+                naive[i * N + j] = cov / std::sqrt(vi * vj);
+            }
+        times.push_back(ms_since(start));
+    }
+    double t_naive = median_of(times);
+    std::cout << std::fixed << std::setprecision(2) << "  direct, sqrt per entry        " << std::setw(8) << t_naive
+              << "\n";
+
+    std::vector<unsigned> thread_counts = {1};
+    if (std::thread::hardware_concurrency() > 1) thread_counts.push_back(std::thread::hardware_concurrency());
+    for (unsigned threads : thread_counts) {
+        ThreadPool pool(threads);
+        RollingCorrelation engine(N, W);
+        engine.update(stream.data(), W, &pool);
+        times.clear();
+        for (size_t u = 0; u < UPDATES; u++) {
+            auto start = clock::now();
+            engine.update(&stream[(W + u) * N], 1, &pool);
+            times.push_back(ms_since(start));
+        }
+        double t = median_of(times), worst = 0;
+        for (size_t e = 0; e < N * N; e++) worst = std::max(worst, std::abs(engine.correlation()[e] - naive[e]));
+        std::cout << "  RollingCorrelation, " << threads << " thread" << (threads > 1 ? "s" : " ") << "     "
+                  << std::setw(8) << t << "   (" << std::setprecision(2) << t_naive / t << "x)   max |diff| "
+                  << std::scientific << worst << std::fixed << "\n";
+    }
+}
+
+// ==================== MATRIX SQUARE ROOT ====================
+// gemm() is a cache-blocked C = A * B for square row-major matrices: KC x NC
+// panels of B stay in L2 while a 4x8 AVX2/FMA register tile walks down the
+// rows. With a pool, 64-row blocks of C go to separate tasks.
+//
+// matrix_sqrt() takes a symmetric positive definite A to A^1/2 and A^-1/2 by
+// the coupled Newton-Schulz iteration
+//   T = (3I - Z Y) / 2,   Y <- Y T,   Z <- T Z,   Y0 = A / c,   Z0 = I
+// which converges quadratically to (A/c)^1/2 and (A/c)^-1/2 when the spectrum
+// of A/c lies in (0, 1]; c = ||A||_F guarantees that. The answers are then
+// sqrt(c) Y and Z / sqrt(c), both factors from one sqrt_rsqrt call. Three
+// GEMMs per step, no divisions and no eigendecomposition; the step count grows
+// with log(condition number).
+
+static const size_t GEMM_MC = 64, GEMM_KC = 256, GEMM_NC = 256;
+
+static void gemm_rows(const double* a, const double* b, double* c, size_t n, size_t i0, size_t i1) {
+    std::fill(c + i0 * n, c + i1 * n, 0.0);
+    for (size_t k0 = 0; k0 < n; k0 += GEMM_KC) {
+        const size_t k1 = std::min(n, k0 + GEMM_KC);
+        for (size_t j0 = 0; j0 < n; j0 += GEMM_NC) {
+            const size_t j1 = std::min(n, j0 + GEMM_NC);
+            size_t i = i0;
+#if defined(__AVX2__) && defined(__FMA__)
+            for (; i + 4 <= i1; i += 4) {
+                size_t j = j0;
+                for (; j + 8 <= j1; j += 8) {
+                    __m256d acc[4][2];
+                    for (int r = 0; r < 4; r++) {
+                        acc[r][0] = _mm256_loadu_pd(c + (i + r) * n + j);
+                        acc[r][1] = _mm256_loadu_pd(c + (i + r) * n + j + 4);
+                    }
+                    for (size_t k = k0; k < k1; k++) {
+                        __m256d b0 = _mm256_loadu_pd(b + k * n + j), b1 = _mm256_loadu_pd(b + k * n + j + 4);
+                        for (int r = 0; r < 4; r++) {
+                            __m256d av = _mm256_broadcast_sd(a + (i + r) * n + k);
+                            acc[r][0] = _mm256_fmadd_pd(av, b0, acc[r][0]);
+                            acc[r][1] = _mm256_fmadd_pd(av, b1, acc[r][1]);
+                        }
+                    }
+                    for (int r = 0; r < 4; r++) {
+                        _mm256_storeu_pd(c + (i + r) * n + j, acc[r][0]);
+                        _mm256_storeu_pd(c + (i + r) * n + j + 4, acc[r][1]);
+                    }
+                }
+                for (int r = 0; r < 4; r++)
+                    for (size_t k = k0; k < k1; k++)
+                        for (size_t jj = j; jj < j1; jj++) c[(i + r) * n + jj] += a[(i + r) * n + k] * b[k * n + jj];
+            }
+#endif
+            for (; i < i1; i++)
+                for (size_t k = k0; k < k1; k++) {
+                    const double av = a[i * n + k];
+                    for (size_t j = j0; j < j1; j++) c[i * n + j] += av * b[k * n + j];
+                }
+        }
+    }
+}
+
+// c = a * b for n x n row-major matrices; c must not alias a or b
+void gemm(const double* a, const double* b, double* c, size_t n, ThreadPool* pool = nullptr) {
+    const size_t blocks = (n + GEMM_MC - 1) / GEMM_MC;
+    auto row_block = [&](size_t blk) { gemm_rows(a, b, c, n, blk * GEMM_MC, std::min(n, blk * GEMM_MC + GEMM_MC)); };
+    if (pool && blocks > 1) pool->parallel_for(blocks, row_block);
+    else for (size_t blk = 0; blk < blocks; blk++) row_block(blk);
+}
+
+struct MatrixSqrtStatus {
+    int iterations = 0;
+    double residual = INFINITY;  // ||I - Z Y||_F at the last step
+    bool converged = false;
+};
+
+// work holds 4 n*n doubles
+static MatrixSqrtStatus matrix_sqrt_work(const double* a, size_t n, double* root, double* inv_root, double* work,
+                                         ThreadPool* pool, int max_iterations) {
+    const size_t nn = n * n;
+    double *y = work, *z = work + nn, *t = work + 2 * nn, *tmp = work + 3 * nn;
+    MatrixSqrtStatus status;
+
+    double frob2 = 0;
+    for (size_t e = 0; e < nn; e++) frob2 += a[e] * a[e];
+    const RootPair<double> norm = sqrt_rsqrt(frob2);
+    if (!(norm.sqrt > 0 && norm.sqrt < INFINITY)) {
+        if (root) std::fill(root, root + nn, NAN);
+        if (inv_root) std::fill(inv_root, inv_root + nn, NAN);
+        return status;
+    }
+    for (size_t e = 0; e < nn; e++) y[e] = a[e] * norm.rsqrt;
+    std::fill(z, z + nn, 0.0);
+    for (size_t i = 0; i < n; i++) z[i * n + i] = 1.0;
+
+    // Stop once the residual is small enough that the step just taken
+    // squares it below rounding, or if it stops shrinking
+    const double tol = 1e-8 * std::sqrt((double)n);
+    double previous = INFINITY;
+    while (status.iterations < max_iterations) {
+        gemm(z, y, t, n, pool);
+        double r2 = 0;
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < n; j++) {
+                double r = (i == j ? 1.0 : 0.0) - t[i * n + j];
+                r2 += r * r;
+                t[i * n + j] = (i == j ? 1.0 : 0.0) + 0.5 * r;
+            }
+        status.residual = std::sqrt(r2);
+        if (!(status.residual < 1e3) || (status.residual < 1e-4 && status.residual > previous)) break;
+        gemm(y, t, tmp, n, pool);
+        std::swap(y, tmp);
+        gemm(t, z, tmp, n, pool);
+        std::swap(z, tmp);
+        status.iterations++;
+        if (status.residual < tol) {
+            status.converged = true;
+            break;
+        }
+        previous = status.residual;
+    }
+    if (status.residual < 1e-4 && status.residual >= previous) status.converged = true;
+
+    const RootPair<double> scale = sqrt_rsqrt(norm.sqrt);
+    if (root)
+        for (size_t e = 0; e < nn; e++) root[e] = y[e] * scale.sqrt;
+    if (inv_root)
+        for (size_t e = 0; e < nn; e++) inv_root[e] = z[e] * scale.rsqrt;
+    return status;
+}
+
+// A^1/2 into root and A^-1/2 into inv_root (either may be null) for a
+// symmetric positive definite n x n matrix. The outputs are only meaningful
+// when status.converged; an indefinite A makes the residual grow and stops
+// early. With a pool the GEMMs are split by row blocks, which pays off from a
+// few hundred rows up.
+MatrixSqrtStatus matrix_sqrt(const double* a, size_t n, double* root, double* inv_root, ThreadPool* pool = nullptr,
+                             int max_iterations = 100) {
+    TraceScope span("matrix_sqrt", n);
+    std::vector<double> work(4 * n * n);
+    return matrix_sqrt_work(a, n, root, inv_root, work.data(), pool, max_iterations);
+}
+
+// count independent n x n matrices stored back to back. Small matrices don't
+// split well, so the pool gets whole matrices instead, one workspace per task.
+// Returns how many converged; per-matrix status is optional.
+size_t matrix_sqrt_batch(const double* a, size_t n, size_t count, double* roots, double* inv_roots,
+                         ThreadPool* pool = nullptr, MatrixSqrtStatus* status = nullptr) {
+    TraceScope span("matrix_sqrt_batch", count);
+    const size_t nn = n * n;
+    const size_t tasks = pool ? std::min<size_t>(count, (size_t)pool->size() * 4) : 1;
+    std::atomic<size_t> converged{0};
+    auto run = [&](size_t task) {
+        std::vector<double> work(4 * nn);
+        size_t ok = 0;
+        for (size_t m = count * task / tasks; m < count * (task + 1) / tasks; m++) {
+            MatrixSqrtStatus s = matrix_sqrt_work(a + m * nn, n, roots ? roots + m * nn : nullptr,
+                                                  inv_roots ? inv_roots + m * nn : nullptr, work.data(), nullptr, 100);
+            if (status) status[m] = s;
+            ok += s.converged;
+        }
+        converged += ok;
+    };
+    if (pool) pool->parallel_for(tasks, run);
+    else run(0);
+    return converged.load();
+}
+
+void matrix_sqrt_benchmark() {
+    typedef std::chrono::high_resolution_clock clock;
+    auto ms_since = [](clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    };
+    std::mt19937_64 rng(95);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+
+    std::cout << "MATRIX SQUARE ROOT (coupled Newton-Schulz on the blocked GEMM)\n";
+    std::cout << std::string(96, '-') << "\n";
+
+    // GEMM against the plain i-k-j loop
+    {
+        const size_t n = 512;
+        std::vector<double> a(n * n), b(n * n), c(n * n), ref(n * n, 0.0);
+        for (double& v : a) v = normal(rng);
+        for (double& v : b) v = normal(rng);
+        auto start = clock::now();
+        for (size_t i = 0; i < n; i++)
+            for (size_t k = 0; k < n; k++)
+                for (size_t j = 0; j < n; j++) ref[i * n + j] += a[i * n + k] * b[k * n + j];
+        double t_plain = ms_since(start);
+        std::vector<double> times;
+        for (int rep = 0; rep < 5; rep++) {
+            start = clock::now();
+            gemm(a.data(), b.data(), c.data(), n, &pool);
+            times.push_back(ms_since(start));
+        }
+        double t_gemm = median_of(times), worst = 0;
+        for (size_t e = 0; e < n * n; e++) worst = std::max(worst, std::abs(c[e] - ref[e]));
+        const double flops = 2.0 * n * n * n;
+        std::cout << std::fixed << std::setprecision(1) << "  gemm " << n << "x" << n << ": plain loop "
+                  << flops / t_plain / 1e6 << " GFLOP/s, blocked " << flops / t_gemm / 1e6 << " GFLOP/s ("
+                  << std::setprecision(2) << t_plain / t_gemm << "x), max |diff| " << std::scientific << worst
+                  << std::fixed << "\n";
+    }
+
+    // Factor-model covariances: k factors plus idiosyncratic variance
+    auto covariance = [&](size_t n, size_t factors, double* out) {
+        std::vector<double> loadings(n * factors);
+        for (double& v : loadings) v = normal(rng);
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < n; j++) {
+                double s = i == j ? 0.05 + 0.01 * (double)(i % 7) : 0.0;
+                for (size_t f = 0; f < factors; f++) s += loadings[i * factors + f] * loadings[j * factors + f];
+                out[i * n + j] = s / (double)factors;
+            }
+    };
+    auto max_error = [](const std::vector<double>& m, const std::vector<double>& want) {
+        double worst = 0, scale = 0;
+        for (size_t e = 0; e < m.size(); e++) {
+            worst = std::max(worst, std::abs(m[e] - want[e]));
+            scale = std::max(scale, std::abs(want[e]));
+        }
+        return worst / scale;
+    };
+
+    for (size_t n : {64, 256, 512}) {
+        std::vector<double> a(n * n), root(n * n), inv(n * n), check(n * n), identity(n * n, 0.0);
+        for (size_t i = 0; i < n; i++) identity[i * n + i] = 1.0;
+        covariance(n, 10, a.data());
+        auto start = clock::now();
+        MatrixSqrtStatus s = matrix_sqrt(a.data(), n, root.data(), inv.data(), &pool);
+        double t = ms_since(start);
+        gemm(root.data(), root.data(), check.data(), n);
+        double e_root = max_error(check, a);
+        gemm(root.data(), inv.data(), check.data(), n);
+        double e_inv = max_error(check, identity);
+        std::cout << "  n=" << std::setw(4) << n << ": " << std::setw(2) << s.iterations << " steps"
+                  << (s.converged ? "" : " (NOT CONVERGED)") << std::setw(10) << std::setprecision(2) << t
+                  << " ms   |S*S - A| " << std::scientific << std::setprecision(1) << e_root << "   |S*S^-1 - I| "
+                  << e_inv << std::fixed << "\n";
+    }
+
+    {
+        const size_t n = 8, count = 20000;
+        std::vector<double> a(n * n * count), roots(n * n * count), inv(n * n * count);
+        for (size_t m = 0; m < count; m++) covariance(n, 3, a.data() + m * n * n);
+        auto start = clock::now();
+        size_t ok = matrix_sqrt_batch(a.data(), n, count, roots.data(), inv.data(), &pool);
+        double t = ms_since(start);
+        std::cout << "  batch of " << count << " " << n << "x" << n << ": " << std::setprecision(2)
+                  << t * 1e6 / count << " ns per matrix, " << ok << " converged\n";
+    }
+}
+
+// ==================== ASYNC BATCH (C++20 COROUTINES) ====================
+// co_await async_sqrt(pool, in, out, tier, stop) runs sqrt_batch over 64K
+// chunks on the pool's workers and resumes the awaiting coroutine on the
+// worker that finishes the last chunk, so the awaiting thread (a reactor, say)
+// is free for the whole pass. The awaitable embeds the pool job and lives in
+// the caller's coroutine frame: an operation allocates nothing. Requesting
+// stop skips chunks that haven't started; the result says how many elements
+// were written. A pool without worker threads runs the pass inline.
+//
+// Coroutine frames themselves come from FramePool when the promise type asks
+// for it, as AsyncTask (a fire-and-forget task) does. Each thread keeps free
+// lists by 64-byte size class; a frame freed on another thread (the usual case
+// once a worker has resumed it) goes back to its owner through a lock-free
+// stack that the owner drains on its next allocation.
+#if defined(SQRT_COROUTINES)
+
+class FramePool {
+public:
+    static void* allocate(size_t size) {
+        const size_t cls = (size + sizeof(Header) + 63) / 64;
+        if (cls > CLASSES) return ::operator new(size);
+        Cache* cache = local();
+        Header* h = cache->free[cls - 1];
+        if (!h && cache->remote.load(std::memory_order_relaxed)) {
+            cache->drain();
+            h = cache->free[cls - 1];
+        }
+        if (h) {
+            cache->free[cls - 1] = h->next;
+            cache->cached[cls - 1]--;
+            recycled_count.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            h = static_cast<Header*>(::operator new(cls * 64));
+            h->owner = cache;
+            h->cls = (uint32_t)cls;
+            fresh_count.fetch_add(1, std::memory_order_relaxed);
+        }
+        return h + 1;
+    }
+
+    static void release(void* p, size_t size) {
+        if ((size + sizeof(Header) + 63) / 64 > CLASSES) return ::operator delete(p);
+        Header* h = static_cast<Header*>(p) - 1;
+        Cache* cache = local();
+        if (h->owner == cache) return cache->put(h);
+        h->next = h->owner->remote.load(std::memory_order_relaxed);
+        while (!h->owner->remote.compare_exchange_weak(h->next, h, std::memory_order_release,
+                                                       std::memory_order_relaxed)) {
+        }
+    }
+
+    static uint64_t fresh() { return fresh_count.load(std::memory_order_relaxed); }
+    static uint64_t recycled() { return recycled_count.load(std::memory_order_relaxed); }
+
+private:
+    static const size_t CLASSES = 16, MAX_CACHED = 64;
+
+    struct Cache;
+    struct alignas(16) Header {
+        Cache* owner;
+        Header* next;
+        uint32_t cls;
+    };
+
+    struct Cache {
+        Header* free[CLASSES] = {};
+        size_t cached[CLASSES] = {};
+        std::atomic<Header*> remote{nullptr};
+
+        void put(Header* h) {
+            if (cached[h->cls - 1] >= MAX_CACHED) return ::operator delete(h);
+            h->next = free[h->cls - 1];
+            free[h->cls - 1] = h;
+            cached[h->cls - 1]++;
+        }
+
+        void drain() {
+            Header* h = remote.exchange(nullptr, std::memory_order_acquire);
+            while (h) {
+                Header* next = h->next;
+                put(h);
+                h = next;
+            }
+        }
+    };
+
+    // Never freed: frames handed to other threads may come back after the
+    // owning thread has exited
+    static Cache* local() {
+        static thread_local Cache* cache = new Cache;
+        return cache;
+    }
+
+    static inline std::atomic<uint64_t> fresh_count{0}, recycled_count{0};
+};
+
+struct AsyncTask {
+    struct promise_type {
+        AsyncTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+        static void* operator new(size_t size) { return FramePool::allocate(size); }
+        static void operator delete(void* p, size_t size) { FramePool::release(p, size); }
+    };
+};
+
+static const size_t ASYNC_CHUNK = 1 << 16;
+
+struct AsyncSqrtResult {
+    size_t completed = 0;  // elements written
+    bool cancelled = false;
+};
+
+template <class T>
+class AsyncSqrt {
+public:
+    AsyncSqrt(ThreadPool& pool, const T* in, T* out, size_t n, SqrtTier tier, std::stop_token stop)
+        : pool(pool), in(in), out(out), n(n), tier(tier), stop(std::move(stop)) {
+        job.run = run_chunk;
+        job.ctx = this;
+        job.tasks = (n + ASYNC_CHUNK - 1) / ASYNC_CHUNK;
+        job.complete = resume;
+    }
+    AsyncSqrt(const AsyncSqrt&) = delete;
+    AsyncSqrt& operator=(const AsyncSqrt&) = delete;
+
+    bool await_ready() const { return n == 0; }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        waiter = handle;
+        if (pool.size() == 1) {
+            for (size_t t = 0; t < job.tasks; t++) run_chunk(this, t);
+            return false;
+        }
+        pool.post(&job);
+        return true;
+    }
+
+    AsyncSqrtResult await_resume() const {
+        return AsyncSqrtResult{completed.load(std::memory_order_relaxed), skipped.load(std::memory_order_relaxed) > 0};
+    }
+
+private:
+    static void run_chunk(void* ctx, size_t task) {
+        AsyncSqrt* op = static_cast<AsyncSqrt*>(ctx);
+        if (op->stop.stop_requested()) {
+            op->skipped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        const size_t lo = task * ASYNC_CHUNK, hi = std::min(op->n, lo + ASYNC_CHUNK);
+        sqrt_batch(op->in + lo, op->out + lo, hi - lo, op->tier);
+        op->completed.fetch_add(hi - lo, std::memory_order_relaxed);
+    }
+
+    // Runs on the worker that finished the last chunk; the coroutine may
+    // destroy this awaitable before waiter.resume() returns
+    static void resume(void* ctx) { static_cast<AsyncSqrt*>(ctx)->waiter.resume(); }
+
+    ThreadPool& pool;
+    const T* in;
+    T* out;
+    size_t n;
+    SqrtTier tier;
+    std::stop_token stop;
+    ThreadPool::Job job;
+    std::coroutine_handle<> waiter;
+    std::atomic<size_t> completed{0}, skipped{0};
+};
+
+// out[i] = sqrt(in[i]) for i < min(in.size(), out.size())
+inline AsyncSqrt<double> async_sqrt(ThreadPool& pool, std::span<const double> in, std::span<double> out,
+                                    SqrtTier tier = SQRT_EXACT, std::stop_token stop = {}) {
+    return AsyncSqrt<double>(pool, in.data(), out.data(), std::min(in.size(), out.size()), tier, std::move(stop));
+}
+
+inline AsyncSqrt<float> async_sqrt(ThreadPool& pool, std::span<const float> in, std::span<float> out,
+                                   SqrtTier tier = SQRT_EXACT, std::stop_token stop = {}) {
+    return AsyncSqrt<float>(pool, in.data(), out.data(), std::min(in.size(), out.size()), tier, std::move(stop));
+}
+
+void async_benchmark() {
+    typedef std::chrono::steady_clock clock;
+    ThreadPool pool(std::max(2u, std::thread::hardware_concurrency()));
+    std::cout << "ASYNC BATCH (C++20 coroutines, pool of " << pool.size() << ")\n";
+    std::cout << std::string(96, '-') << "\n";
+
+    // A reactor that wakes every 50 us while a pass is in flight
+    struct ReactorLoad {
+        size_t ticks = 0;
+        double worst_gap_us = 0;
+    };
+    auto reactor = [](std::atomic<bool>& done) {
+        ReactorLoad load;
+        auto last = clock::now();
+        while (!done.load(std::memory_order_acquire)) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            auto now = clock::now();
+            load.worst_gap_us = std::max(load.worst_gap_us, std::chrono::duration<double, std::micro>(now - last).count());
+            last = now;
+            load.ticks++;
+        }
+        return load;
+    };
+
+    const size_t N = 10000000;
+    std::vector<double> in(N), out(N);
+    for (size_t i = 0; i < N; i++) in[i] = 1.0 + (double)(i % 100000);
+
+    auto start = clock::now();
+    sqrt_batch(in.data(), out.data(), N);
+    double blocking_ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+    std::atomic<bool> done{false};
+    AsyncSqrtResult result;
+    auto pass = [&](std::stop_token stop) -> AsyncTask {
+        result = co_await async_sqrt(pool, std::span<const double>(in), std::span<double>(out), SQRT_EXACT, stop);
+        done.store(true, std::memory_order_release);
+    };
+    start = clock::now();
+    pass({});
+    ReactorLoad load = reactor(done);
+    double async_ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    std::cout << std::fixed << std::setprecision(2) << "  " << N << " roots, blocking sqrt_batch: " << blocking_ms
+              << " ms, reactor stalled for all of it\n"
+              << "  " << N << " roots, co_await async_sqrt:  " << async_ms << " ms, reactor ran " << load.ticks
+              << " ticks, worst gap " << load.worst_gap_us << " us, " << result.completed << " written\n";
+
+    // Cancel right after posting: chunks not yet started are skipped
+    std::stop_source source;
+    done.store(false);
+    pass(source.get_token());
+    source.request_stop();
+    reactor(done);
+    std::cout << "  cancelled pass: " << result.completed << " of " << N << " written, cancelled="
+              << (result.cancelled ? "yes" : "no") << "\n";
+
+    // Per-operation overhead: one coroutine per small pass, run back to back
+    const size_t SMALL = 4096, OPS = 2000;
+    std::vector<double> small_in(in.begin(), in.begin() + SMALL), small_out(SMALL);
+    uint64_t fresh_before = FramePool::fresh(), recycled_before = FramePool::recycled();
+    // The coroutine refers to the lambda's captures, so the lambda must
+    // outlive every call, not just the statement that starts it
+    auto small_pass = [&]() -> AsyncTask {
+        co_await async_sqrt(pool, std::span<const double>(small_in), std::span<double>(small_out));
+        done.store(true, std::memory_order_release);
+    };
+    start = clock::now();
+    for (size_t op = 0; op < OPS; op++) {
+        done.store(false, std::memory_order_relaxed);
+        small_pass();
+        while (!done.load(std::memory_order_acquire)) std::this_thread::yield();
+    }
+    double async_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / OPS;
+    start = clock::now();
+    for (size_t op = 0; op < OPS; op++) sqrt_batch(small_in.data(), small_out.data(), SMALL);
+    double direct_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / OPS;
+    std::cout << "  " << SMALL << "-element passes: " << std::setprecision(0) << async_ns << " ns awaited vs "
+              << direct_ns << " ns inline; frames: " << FramePool::fresh() - fresh_before << " fresh, "
+              << FramePool::recycled() - recycled_before << " recycled\n";
+}
+#endif
+
+// ==================== SHARED-MEMORY SERVICE ====================
+// sqrt serve runs a daemon for processes that each have small batches. One
+// POSIX shared memory object holds a header, a slot per client and a data
+// arena per client. A slot is a pair of single-producer single-consumer rings:
+// the client pushes requests that name spans by offset into its own arena, the
+// daemon pushes responses. Nothing is copied: the daemon runs sqrt_batch on
+// the arena in place.
+//
+// Daemon threads are pinned to consecutive CPUs and each serves every
+// threads-th slot. A sweep collects what every client has queued, runs the
+// kernels back to back, then publishes the responses, so a busy daemon pays
+// the polling cost once per sweep rather than once per request. When idle it
+// spins, then yields, then sleeps on a futex doorbell in the header that a
+// client rings only if someone is asleep; clients wait for responses the same
+// way on a per-slot doorbell. Slots whose process has died are reclaimed about
+// once a second.
+//
+// Ring indices only ever increase and a request ID carries the slot's claim
+// generation, so a client can recognize and drop responses meant for an
+// earlier owner of its slot.
+
+static const uint64_t SERVICE_MAGIC = 0x31767265537271ull;  // "qrServ1"
+static const uint32_t SERVICE_RING = 64;
+
+struct ServiceRequest {
+    uint64_t id;
+    uint64_t in, out;  // byte offsets into the client's arena
+    uint32_t count;
+    uint8_t f32, tier, pad[2];
+};
+
+struct ServiceResponse {
+    uint64_t id;
+    uint32_t ok;
+    uint32_t pad;
+};
+
+template <class T, uint32_t N>
+struct SpscRing {
+    alignas(64) std::atomic<uint32_t> head{0};  // next entry the consumer takes
+    alignas(64) std::atomic<uint32_t> tail{0};  // next entry the producer fills
+    alignas(64) T entries[N];
+
+    uint32_t free_space() const {
+        return N - (tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire));
+    }
+
+    bool push(const T& v) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N) return false;
+        entries[t % N] = v;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T* v) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        *v = entries[h % N];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "ring indices must be address-free atomics");
+
+enum ServiceSlotState : uint32_t { SLOT_FREE, SLOT_CLAIMED };
+
+// A sleeper reads the doorbell, registers, re-checks for work, then waits
+// for the doorbell to change; a waker publishes work, then rings only if it
+// sees a sleeper. Work is published with a release store, so each side puts
+// a seq_cst fence between its store and its check of the other side's; then
+// at least one of them sees the other and no wakeup is lost.
+struct Doorbell {
+    std::atomic<uint32_t> ring{0}, sleepers{0};
+
+    template <class Ready>
+    void sleep(Ready ready, long timeout_us) {
+        uint32_t seen = ring.load(std::memory_order_seq_cst);
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!ready()) {
+            struct timespec ts = {timeout_us / 1000000, (timeout_us % 1000000) * 1000};
+            syscall(SYS_futex, &ring, FUTEX_WAIT, seen, &ts, nullptr, 0);
+        }
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void wake() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_seq_cst) == 0) return;
+        ring.fetch_add(1, std::memory_order_seq_cst);
+        syscall(SYS_futex, &ring, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+};
+
+struct ServiceSlot {
+    alignas(64) std::atomic<uint32_t> state{SLOT_FREE};
+    std::atomic<int32_t> pid{0};
+    std::atomic<uint32_t> generation{0};
+    Doorbell responded;
+    SpscRing<ServiceRequest, SERVICE_RING> requests;
+    SpscRing<ServiceResponse, SERVICE_RING> responses;
+};
+
+struct ServiceHeader {
+    std::atomic<uint64_t> magic;  // stored last, once everything else is set up
+    uint32_t clients;
+    int32_t daemon_pid;
+    uint64_t arena_bytes, slots_offset, arenas_offset, total_bytes;
+    std::atomic<uint32_t> stop;
+    Doorbell requested;
+};
+
+struct ServiceConfig {
+    std::string name = "/sqrt-service";
+    uint32_t clients = 8;
+    size_t arena_bytes = (size_t)8 << 20;
+    unsigned threads = 1;
+    int first_cpu = -1;  // -1: last CPU the process may use, counting down
+    bool realtime = false;  // realtime_enter() first; threads spin and never sleep
+    int fifo_priority = 0;
+};
+
+static size_t round_up(size_t n, size_t to) { return (n + to - 1) / to * to; }
+
+// Pause-loop budget before yielding; on a single CPU spinning only delays
+// the other side, so go straight to yielding
+static unsigned service_spins(unsigned budget) { return std::thread::hardware_concurrency() > 1 ? budget : 0; }
+
+static volatile sig_atomic_t service_signal = 0;
+
+// True if name is a service segment whose daemon is still running
+static bool service_live(const char* name, pid_t* daemon_pid) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return false;
+    struct stat st;
+    bool live = false;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ServiceHeader)) {
+        void* p = mmap(nullptr, sizeof(ServiceHeader), PROT_READ, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED) {
+            const ServiceHeader* h = (const ServiceHeader*)p;
+            *daemon_pid = h->daemon_pid;
+            live = h->magic.load(std::memory_order_acquire) == SERVICE_MAGIC && h->daemon_pid > 0 &&
+                   (kill(h->daemon_pid, 0) == 0 || errno == EPERM);
+            munmap(p, sizeof(ServiceHeader));
+        }
+    }
+    close(fd);
+    return live;
+}
+
+// Creates the segment (replacing a stale one, never a live daemon's) and
+// serves until SIGINT, SIGTERM or the header's stop flag
+int service_run(const ServiceConfig& cfg) {
+    pid_t owner = 0;
+    if (service_live(cfg.name.c_str(), &owner)) {
+        std::cerr << "sqrt serve: " << cfg.name << " is already served by pid " << owner << "\n";
+        return 1;
+    }
+
+    const size_t slots_offset = 4096;
+    const size_t arenas_offset = round_up(slots_offset + cfg.clients * sizeof(ServiceSlot), (size_t)2 << 20);
+    const size_t arena_bytes = round_up(cfg.arena_bytes, 4096);
+    const size_t total = arenas_offset + cfg.clients * arena_bytes;
+
+    // Before the mmap, so the segment is locked and populated as it's mapped
+    RealtimeStatus rt;
+    if (cfg.realtime) {
+        RealtimeConfig rc;
+        rc.fifo_priority = cfg.fifo_priority;
+        if (cfg.first_cpu >= 0)
+            for (unsigned t = 0; t < cfg.threads; t++) rc.cpus.push_back(cfg.first_cpu + (int)t);
+        rt = realtime_enter(rc);
+        for (const std::string& w : rt.warnings) std::cerr << "sqrt serve: " << w << "\n";
+    }
+
+    shm_unlink(cfg.name.c_str());
+    int fd = shm_open(cfg.name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) { std::perror(cfg.name.c_str()); return 1; }
+    if (ftruncate(fd, (off_t)total) != 0) { std::perror("ftruncate"); close(fd); shm_unlink(cfg.name.c_str()); return 1; }
+    char* base = (char*)mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) { std::perror("mmap"); shm_unlink(cfg.name.c_str()); return 1; }
+
+    ServiceHeader* header = new (base) ServiceHeader;
+    ServiceSlot* slots = reinterpret_cast<ServiceSlot*>(base + slots_offset);
+    for (uint32_t s = 0; s < cfg.clients; s++) new (&slots[s]) ServiceSlot;
+    header->clients = cfg.clients;
+    header->daemon_pid = (int32_t)getpid();
+    header->arena_bytes = arena_bytes;
+    header->slots_offset = slots_offset;
+    header->arenas_offset = arenas_offset;
+    header->total_bytes = total;
+    header->stop.store(0, std::memory_order_relaxed);
+    new (&header->requested) Doorbell;
+    header->magic.store(SERVICE_MAGIC, std::memory_order_release);
+
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = [](int) { service_signal = 1; };
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    std::vector<int> cpus;
+    for (int c = CPU_SETSIZE - 1; c >= 0; c--)
+        if (CPU_ISSET(c, &allowed)) cpus.push_back(c);
+    if (cfg.first_cpu >= 0) cpus.assign(1, cfg.first_cpu);
+
+    auto serve = [&](unsigned t) {
+        sqrt_trace_thread_name("service");
+        if (cfg.realtime) {
+            realtime_thread_setup(rt, t);
+        } else if (!cpus.empty()) {
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(cfg.first_cpu >= 0 ? cfg.first_cpu + (int)t : cpus[t % cpus.size()], &one);
+            sched_setaffinity(0, sizeof(one), &one);
+        }
+        struct Pending {
+            ServiceSlot* slot;
+            ServiceResponse response;
+        };
+        std::vector<Pending> sweep;
+        sweep.reserve((size_t)cfg.clients * SERVICE_RING);
+        const unsigned spin_limit = service_spins(2000);
+        unsigned idle = 0;
+        auto last_reap = std::chrono::steady_clock::now();
+        while (!service_signal && !header->stop.load(std::memory_order_relaxed)) {
+            sweep.clear();
+            for (uint32_t s = t; s < cfg.clients; s += cfg.threads) {
+                ServiceSlot& slot = slots[s];
+                if (slot.state.load(std::memory_order_acquire) != SLOT_CLAIMED) continue;
+                char* arena = base + arenas_offset + s * arena_bytes;
+                // Only take what can be answered, so a slow reader can't overflow its responses
+                for (uint32_t room = slot.responses.free_space(); room > 0; room--) {
+                    ServiceRequest req;
+                    if (!slot.requests.pop(&req)) break;
+                    const size_t elem = req.f32 ? sizeof(float) : sizeof(double);
+                    const size_t bytes = (size_t)req.count * elem;
+                    const bool ok = req.tier <= SQRT_FAST && req.in % elem == 0 && req.out % elem == 0 &&
+                                    req.in <= arena_bytes && bytes <= arena_bytes - req.in &&
+                                    req.out <= arena_bytes && bytes <= arena_bytes - req.out;
+                    if (ok) {
+                        TraceScope span("service request", req.count);
+                        if (req.f32) sqrt_batch((const float*)(arena + req.in), (float*)(arena + req.out), req.count, (SqrtTier)req.tier);
+                        else sqrt_batch((const double*)(arena + req.in), (double*)(arena + req.out), req.count, (SqrtTier)req.tier);
+                    }
+                    sweep.push_back(Pending{&slot, ServiceResponse{req.id, ok, 0}});
+                }
+            }
+            for (const Pending& p : sweep) p.slot->responses.push(p.response);
+            for (size_t i = 0; i < sweep.size(); i++)
+                if (i + 1 == sweep.size() || sweep[i + 1].slot != sweep[i].slot) sweep[i].slot->responded.wake();
+            if (!sweep.empty()) {
+                idle = 0;
+                continue;
+            }
+
+            if (cfg.realtime || ++idle <= spin_limit) {
+                _mm_pause();
+            } else if (idle <= spin_limit + 100) {
+                sched_yield();
+            } else {
+                header->requested.sleep([&] {
+                    for (uint32_t s = t; s < cfg.clients; s += cfg.threads)
+                        if (slots[s].requests.tail.load(std::memory_order_seq_cst) !=
+                            slots[s].requests.head.load(std::memory_order_relaxed))
+                            return true;
+                    return header->stop.load(std::memory_order_relaxed) != 0;
+                }, 1000000);
+                idle = 0;
+            }
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_reap > std::chrono::seconds(1)) {
+                last_reap = now;
+                for (uint32_t s = t; s < cfg.clients; s += cfg.threads) {
+                    int32_t pid = slots[s].pid.load(std::memory_order_relaxed);
+                    if (slots[s].state.load(std::memory_order_acquire) != SLOT_CLAIMED || pid <= 0) continue;
+                    if (kill(pid, 0) == 0 || errno != ESRCH) continue;
+                    ServiceRequest dropped;
+                    while (slots[s].requests.pop(&dropped)) {
+                    }
+                    slots[s].pid.store(0, std::memory_order_relaxed);
+                    slots[s].state.store(SLOT_FREE, std::memory_order_release);
+                }
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < cfg.threads; t++) threads.emplace_back(serve, t);
+    serve(0);
+    for (std::thread& th : threads) th.join();
+
+    header->magic.store(0, std::memory_order_release);
+    munmap(base, total);
+    shm_unlink(cfg.name.c_str());
+    return 0;
+}
+
+// Client side. Spans passed to submit() must lie inside arena(); at most
+// SERVICE_RING requests may be outstanding. The client keeps the result of
+// the last SERVICE_RING completed requests, so wait() on a ticket answers for
+// that request alone, whatever order tickets are waited on.
+class SqrtServiceClient {
+public:
+    SqrtServiceClient() = default;
+    SqrtServiceClient(const SqrtServiceClient&) = delete;
+    SqrtServiceClient& operator=(const SqrtServiceClient&) = delete;
+    ~SqrtServiceClient() { disconnect(); }
+
+    // False with errno set (ENOENT: no daemon, EBUSY: no free slot, EPROTO: not a service segment)
+    bool connect(const char* name = "/sqrt-service") {
+        disconnect();
+        int fd = shm_open(name, O_RDWR, 0);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ServiceHeader)) {
+            close(fd);
+            errno = EPROTO;
+            return false;
+        }
+        base = (char*)mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) {
+            base = nullptr;
+            return false;
+        }
+        mapped = (size_t)st.st_size;
+        header = reinterpret_cast<ServiceHeader*>(base);
+        if (header->magic.load(std::memory_order_acquire) != SERVICE_MAGIC || header->total_bytes != mapped) {
+            unmap();
+            errno = EPROTO;
+            return false;
+        }
+        ServiceSlot* slots = reinterpret_cast<ServiceSlot*>(base + header->slots_offset);
+        for (uint32_t s = 0; s < header->clients; s++) {
+            uint32_t expected = SLOT_FREE;
+            if (!slots[s].state.compare_exchange_strong(expected, SLOT_CLAIMED, std::memory_order_acq_rel)) continue;
+            slot = &slots[s];
+            slot->pid.store((int32_t)getpid(), std::memory_order_relaxed);
+            generation = slot->generation.fetch_add(1, std::memory_order_relaxed) + 1;
+            arena_base = base + header->arenas_offset + s * header->arena_bytes;
+            sequence = completed = 0;
+            failed = 0;
+            return true;
+        }
+        unmap();
+        errno = EBUSY;
+        return false;
+    }
+
+    // Waits for outstanding requests, then frees the slot
+    void disconnect() {
+        if (slot) {
+            if (sequence != completed) wait(((uint64_t)generation << 32) | sequence);
+            slot->pid.store(0, std::memory_order_relaxed);
+            slot->state.store(SLOT_FREE, std::memory_order_release);
+            slot = nullptr;
+        }
+        unmap();
+    }
+
+    bool connected() const { return slot != nullptr; }
+    void* arena() const { return arena_base; }
+    size_t arena_bytes() const { return header ? header->arena_bytes : 0; }
+
+    // out = sqrt(in) for count elements; returns a ticket for wait(), or 0 if the ring is full
+    uint64_t submit(const double* in, double* out, size_t count, SqrtTier tier = SQRT_EXACT) {
+        return submit_raw(in, out, count, false, tier);
+    }
+    uint64_t submit(const float* in, float* out, size_t count, SqrtTier tier = SQRT_EXACT) {
+        return submit_raw(in, out, count, true, tier);
+    }
+
+    // True once the request has been served; false if the daemon rejected it
+    // or went away, or if SERVICE_RING later requests completed since and its
+    // result is no longer kept
+    bool wait(uint64_t ticket) {
+        if (!slot || !ticket) return false;
+        if ((ticket >> 32) != generation) return false;
+        const unsigned spin_limit = service_spins(1000);
+        unsigned spins = 0;
+        // Sequence numbers wrap after 2^32 requests, so order them by distance
+        while ((int32_t)((uint32_t)ticket - completed) > 0) {
+            ServiceResponse r;
+            if (slot->responses.pop(&r)) {
+                if ((r.id >> 32) != generation) continue;  // left over from a previous owner
+                completed = (uint32_t)r.id;
+                const uint64_t bit = 1ull << (completed % SERVICE_RING);
+                failed = r.ok ? failed & ~bit : failed | bit;
+                spins = 0;
+                continue;
+            }
+            if (++spins <= spin_limit) {
+                _mm_pause();
+            } else if (spins <= spin_limit + 100) {
+                sched_yield();
+            } else {
+                if (header->magic.load(std::memory_order_acquire) != SERVICE_MAGIC ||
+                    (kill(header->daemon_pid, 0) != 0 && errno == ESRCH))
+                    return false;
+                slot->responded.sleep([&] {
+                    return slot->responses.tail.load(std::memory_order_seq_cst) !=
+                           slot->responses.head.load(std::memory_order_relaxed);
+                }, 100000);
+                spins = spin_limit;
+            }
+        }
+        if (completed - (uint32_t)ticket >= SERVICE_RING) return false;
+        return !(failed >> ((uint32_t)ticket % SERVICE_RING) & 1);
+    }
+
+    bool sqrt(const double* in, double* out, size_t count, SqrtTier tier = SQRT_EXACT) {
+        return wait(submit(in, out, count, tier));
+    }
+    bool sqrt(const float* in, float* out, size_t count, SqrtTier tier = SQRT_EXACT) {
+        return wait(submit(in, out, count, tier));
+    }
+
+private:
+    uint64_t submit_raw(const void* in, void* out, size_t count, bool f32, SqrtTier tier) {
+        if (!slot || count > UINT32_MAX) return 0;
+        ServiceRequest req;
+        std::memset(&req, 0, sizeof(req));
+        const uint32_t next = sequence + 1 ? sequence + 1 : 1;  // 0 is never a sequence number
+        req.id = ((uint64_t)generation << 32) | next;
+        req.in = (uint64_t)((const char*)in - arena_base);
+        req.out = (uint64_t)((char*)out - arena_base);
+        req.count = (uint32_t)count;
+        req.f32 = f32;
+        req.tier = (uint8_t)tier;
+        if (!slot->requests.push(req)) return 0;
+        header->requested.wake();
+        sequence = next;
+        return req.id;
+    }
+
+    void unmap() {
+        if (base) munmap(base, mapped);
+        base = nullptr;
+        header = nullptr;
+        arena_base = nullptr;
+    }
+
+    friend struct SqrtServiceClientTest;  // tests/regress.cpp starts a client near the sequence wrap
+
+    char* base = nullptr;
+    size_t mapped = 0;
+    ServiceHeader* header = nullptr;
+    ServiceSlot* slot = nullptr;
+    char* arena_base = nullptr;
+    uint32_t generation = 0, sequence = 0, completed = 0;
+    uint64_t failed = 0;  // bit s % SERVICE_RING: request s was rejected
+    static_assert(SERVICE_RING <= 64, "one result bit per ring entry");
+};
+
+int run_serve(int argc, char** argv) {
+    ServiceConfig cfg;
+    for (int i = 0; i < argc; i++) {
+        if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+            cfg.name = argv[++i];
+            if (cfg.name[0] != '/') cfg.name = "/" + cfg.name;
+        } else if (!std::strcmp(argv[i], "-c") && i + 1 < argc) {
+            cfg.clients = (uint32_t)std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "-a") && i + 1 < argc) {
+            cfg.arena_bytes = (size_t)std::max(1, std::atoi(argv[++i])) << 20;
+        } else if (!std::strcmp(argv[i], "-j") && i + 1 < argc) {
+            cfg.threads = (unsigned)std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "-C") && i + 1 < argc) {
+            cfg.first_cpu = std::max(0, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "-R")) {
+            cfg.realtime = true;
+        } else if (!std::strcmp(argv[i], "-F") && i + 1 < argc) {
+            cfg.realtime = true;
+            cfg.fifo_priority = std::min(std::max(1, std::atoi(argv[++i])), 99);
+        } else {
+            std::cerr << "usage: sqrt serve [-n shm_name] [-c clients] [-a arena_MiB] [-j threads] [-C first_cpu]"
+                         " [-R] [-F fifo_priority]\n";
+            return 2;
+        }
+    }
+    cfg.threads = std::min<unsigned>(cfg.threads, cfg.clients);
+    std::cerr << "sqrt serve: " << cfg.name << ", " << cfg.clients << " clients x " << (cfg.arena_bytes >> 20)
+              << " MiB, " << cfg.threads << " thread" << (cfg.threads > 1 ? "s" : "") << "\n";
+    return service_run(cfg);
+}
+
+// Forks a daemon and times client round trips against in-process sqrt_batch
+// on the same arena memory
+void ipc_benchmark() {
+    ServiceConfig cfg;
+    cfg.name = "/sqrt-bench-" + std::to_string(getpid());
+    cfg.clients = 2;
+    cfg.arena_bytes = (size_t)2 << 20;
+    std::cout.flush();
+    pid_t child = fork();
+    if (child < 0) { std::perror("fork"); return; }
+    if (child == 0) _exit(service_run(cfg));
+
+    SqrtServiceClient client;
+    for (int attempt = 0; attempt < 2000 && !client.connect(cfg.name.c_str()); attempt++) usleep(1000);
+    std::cout << "SHARED-MEMORY SERVICE (daemon pid " << child << ", " << cfg.name << ")\n";
+    std::cout << std::string(96, '-') << "\n";
+    if (!client.connected()) {
+        std::perror("connect");
+        kill(child, SIGTERM);
+        waitpid(child, nullptr, 0);
+        return;
+    }
+
+    double* in = (double*)client.arena();
+    const size_t MAX = client.arena_bytes() / (2 * sizeof(double));
+    double* out = in + MAX;
+    for (size_t i = 0; i < MAX; i++) in[i] = 1.0 + (double)i;
+
+    std::cout << "  elements   IPC round trip   in-process   overhead   (median ns)\n";
+    bool all_ok = true;
+    for (size_t count : {1, 16, 256, 4096, 65536}) {
+        const int reps = count >= 4096 ? 200 : 2000;
+        std::vector<double> ipc, local;
+        for (int r = 0; r < reps; r++) {
+            auto start = std::chrono::steady_clock::now();
+            all_ok &= client.sqrt(in, out, count);
+            ipc.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+            start = std::chrono::steady_clock::now();
+            sqrt_batch(in, out, count);
+            local.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+        }
+        double t_ipc = median_of(ipc), t_local = median_of(local);
+        std::cout << std::fixed << std::setprecision(0) << std::setw(10) << count << std::setw(17) << t_ipc
+                  << std::setw(13) << t_local << std::setw(11) << t_ipc - t_local << "\n";
+    }
+    all_ok &= out[99] == std::sqrt(100.0);
+    std::cout << "  results " << (all_ok ? "verified" : "WRONG") << "\n";
+
+    client.disconnect();
+    kill(child, SIGTERM);
+    waitpid(child, nullptr, 0);
+}
+
+// The same workload before and after realtime_enter(): fresh output buffers,
+// one pool dispatch per 64K-element step, per-step latency and rusage deltas.
+// SQRT_RT_FIFO=<priority> adds SCHED_FIFO.
+static void realtime_profile_report() {
+    const size_t N = (size_t)4 << 20, STEP = (size_t)1 << 16, STEPS = N / STEP;
+    std::cout << "REAL-TIME PROFILE (" << N << " doubles, " << STEPS << " steps of " << STEP << ")\n";
+    std::cout << std::string(96, '-') << "\n";
+    std::cout << "  profile     threads   p50 us   p99 us   max us   minflt  majflt  vol csw  invol csw\n";
+
+    std::vector<double> lat;
+    lat.reserve(STEPS);
+    bool all_ok = true;
+    auto run = [&](const char* label, ThreadPool& pool) {
+        double* in = (double*)std::malloc(N * sizeof(double));
+        double* out = (double*)std::malloc(N * sizeof(double));
+        for (size_t i = 0; i < N; i++) in[i] = 1.0 + (double)i;
+        const size_t tasks = pool.size();
+        lat.clear();
+        RusageDelta d = rusage_during([&] {
+            for (size_t s = 0; s < STEPS; s++) {
+                auto start = std::chrono::steady_clock::now();
+                pool.parallel_for(tasks, [&](size_t t) {
+                    size_t lo = s * STEP + t * STEP / tasks, hi = s * STEP + (t + 1) * STEP / tasks;
+                    sqrt_batch(in + lo, out + lo, hi - lo);
+                });
+                lat.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            }
+        });
+        all_ok &= out[N - 1] == std::sqrt((double)N);
+        std::free(in);
+        std::free(out);
+        std::sort(lat.begin(), lat.end());
+        std::cout << "  " << std::left << std::setw(12) << label << std::right << std::setw(7) << pool.size()
+                  << std::fixed << std::setprecision(1) << std::setw(9) << quantile_sorted(lat, 0.5)
+                  << std::setw(9) << quantile_sorted(lat, 0.99) << std::setw(9) << lat.back()
+                  << std::setw(9) << d.minor_faults << std::setw(8) << d.major_faults
+                  << std::setw(9) << d.voluntary_switches << std::setw(11) << d.involuntary_switches << "\n";
+        return d;
+    };
+
+    {
+        ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+        run("default", pool);
+    }
+
+    RealtimeConfig cfg;
+    if (const char* fifo = std::getenv("SQRT_RT_FIFO")) cfg.fifo_priority = std::atoi(fifo);
+    RealtimeStatus rt = realtime_enter(cfg);
+    RusageDelta d;
+    {
+        ThreadPool pool((unsigned)std::min<size_t>(rt.cpus.size(), std::max(1u, std::thread::hardware_concurrency())),
+                        realtime_pool_options(&rt));
+        run("realtime", pool);  // first pass warms the pool and code
+        d = run("realtime", pool);
+    }
+
+    std::cout << "  memory " << (rt.locked ? "locked" : "NOT locked") << ", cpus";
+    for (int cpu : rt.cpus) std::cout << " " << cpu;
+    if (rt.fifo_priority > 0) std::cout << ", SCHED_FIFO " << rt.fifo_priority;
+    std::cout << "\n";
+    for (const std::string& w : rt.warnings) std::cout << "  warning: " << w << "\n";
+    std::cout << "  self-check: " << (d.clean() ? "no page faults or voluntary context switches" : "FAULTS OR BLOCKING")
+              << " in the steady-state run; results " << (all_ok ? "verified" : "WRONG") << "\n";
+}
+
+// realtime_enter() changes the whole process (locked memory, malloc tuning,
+// affinity, scheduling policy) and can't be undone, so the profile runs in a
+// forked child and later benchmarks see the process as it was
+void realtime_benchmark() {
+    std::cout.flush();
+    pid_t child = fork();
+    if (child < 0) { std::perror("fork"); return; }
+    if (child == 0) {
+        realtime_profile_report();
+        std::cout.flush();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) std::cout << "  real-time profile child failed\n";
+}
+
+// ==================== PLUGIN KERNELS ====================
+// sqrt plugin lib.so ...: dlopen()s shared objects exporting the table in
+// sqrt_plugin.h and runs their kernels next to the built-in ones under one
+// methodology: every positive normal float (doubles sampled as in the range
+// proofs), special inputs against std::sqrt, the batch entry point on random
+// normals, then interleaved rounds on the speed test's data with its
+// statistics. Built-ins are called through the same function pointers as
+// plugins, so neither side is inlined into the timing loops.
+
+static void sqrt_batch_exact_f(const float* in, float* out, size_t n) { sqrt_batch(in, out, n, SQRT_EXACT); }
+static void sqrt_batch_fast_f(const float* in, float* out, size_t n) { sqrt_batch(in, out, n, SQRT_FAST); }
+static void sqrt_batch_exact_d(const double* in, double* out, size_t n) { sqrt_batch(in, out, n, SQRT_EXACT); }
+static void sqrt_batch_optimal_d(const double* in, double* out, size_t n) { sqrt_batch(in, out, n, SQRT_OPTIMAL); }
+
+// The first kernel of each type is the baseline for that type
+static const sqrt_plugin_kernel BUILTIN_KERNELS[] = {
+    {"std::sqrt", SQRT_PLUGIN_F32, "scalar", std_sqrt_f, nullptr, sqrt_batch_exact_f, nullptr},
+    {"sqrt_sse_fast", SQRT_PLUGIN_F32, "sse", sqrt_sse_fast, nullptr, sqrt_batch_fast_f, nullptr},
+    {"std::sqrt", SQRT_PLUGIN_F64, "scalar", nullptr, std_sqrt_d, nullptr, sqrt_batch_exact_d},
+    {"sqrt_optimal", SQRT_PLUGIN_F64, "scalar", nullptr, sqrt_optimal, nullptr, sqrt_batch_optimal_d},
+};
+
+struct PluginKernel {
+    std::string source;  // "built-in" or the library path
+    const sqrt_plugin_kernel* kernel;
+};
+
+// True when the CPU has every entry of a comma-separated ISA list
+static bool plugin_isa_supported(const char* isa, std::string* missing) {
+    if (!isa) return true;
+    __builtin_cpu_init();
+    std::stringstream list(isa);
+    std::string name;
+    while (std::getline(list, name, ',')) {
+        name.erase(0, name.find_first_not_of(' '));
+        name.erase(name.find_last_not_of(' ') + 1);
+        bool ok = name.empty() || name == "scalar" ||
+                  (name == "sse" && __builtin_cpu_supports("sse")) ||
+                  (name == "sse2" && __builtin_cpu_supports("sse2")) ||
+                  (name == "sse4.1" && __builtin_cpu_supports("sse4.1")) ||
+                  (name == "avx" && __builtin_cpu_supports("avx")) ||
+                  (name == "avx2" && __builtin_cpu_supports("avx2")) ||
+                  (name == "fma" && __builtin_cpu_supports("fma")) ||
+                  (name == "avx512f" && __builtin_cpu_supports("avx512f"));
+        if (!ok) {
+            *missing = name;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Appends the usable kernels of one plugin and warns about the rest. The
+// library stays loaded for the life of the process.
+static bool load_plugin(const char* path, std::vector<PluginKernel>* kernels) {
+    void* lib = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!lib) {
+        std::cerr << "sqrt plugin: " << dlerror() << "\n";
+        return false;
+    }
+    auto entry = reinterpret_cast<const sqrt_plugin_table* (*)()>(dlsym(lib, SQRT_PLUGIN_ENTRY));
+    const sqrt_plugin_table* table = entry ? entry() : nullptr;
+    if (!table || table->abi != SQRT_PLUGIN_ABI || (table->count > 0 && !table->kernels)) {
+        std::cerr << "sqrt plugin: " << path << ": "
+                  << (!entry ? "no " SQRT_PLUGIN_ENTRY "()" : !table ? "null kernel table"
+                      : table->abi != SQRT_PLUGIN_ABI ? "ABI version mismatch" : "null kernel array")
+                  << "\n";
+        dlclose(lib);
+        return false;
+    }
+    for (uint32_t i = 0; i < table->count; i++) {
+        const sqrt_plugin_kernel& k = table->kernels[i];
+        std::string missing;
+        if (!k.name)
+            std::cerr << "sqrt plugin: " << path << ": kernel " << i << " has no name, skipped\n";
+        else if (!(k.type == SQRT_PLUGIN_F32 ? (bool)k.scalar_f32 : k.type == SQRT_PLUGIN_F64 && k.scalar_f64))
+            std::cerr << "sqrt plugin: " << path << ": " << k.name << ": bad type or no scalar function, skipped\n";
+        else if (!plugin_isa_supported(k.isa, &missing))
+            std::cerr << "sqrt plugin: " << path << ": " << k.name << ": CPU lacks " << missing << ", skipped\n";
+        else
+            kernels->push_back(PluginKernel{path, &k});
+    }
+    return true;
+}
+
+struct PluginAccuracy {
+    RangeProof scalar;
+    double batch_max_ulp = -1;  // -1: no batch entry point
+    int special_mismatches = 0, specials = 0;
+    double test_values_error = 0;  // the analysis' MAXIMUM ERRORS metric
+};
+
+template <class T>
+static bool same_result(T a, T b) {
+    return (std::isnan(a) && std::isnan(b)) || bits_of(a) == bits_of(b);
+}
+
+// Specials, the analysis' test values and the batch path; the scalar sweep is
+// the range proof's
+template <class T>
+static void plugin_accuracy(T (*scalar)(T), void (*batch)(const T*, T*, size_t), PluginAccuracy* acc) {
+    typedef std::numeric_limits<T> L;
+    const T specials[] = {T(0), -T(0), L::denorm_min(), L::min() / 2, L::min(), L::max(),
+                          L::infinity(), -L::infinity(), T(-1), L::quiet_NaN()};
+    const size_t SPECIALS = sizeof(specials) / sizeof(specials[0]);
+    for (T x : specials) acc->special_mismatches += !same_result(scalar(x), (T)std::sqrt(x));
+    acc->specials = (int)SPECIALS;
+
+    for (double v : {0.0, 0.25, 1.0, 2.0, 4.0, 16.0, 100.0, 1234.5678, 1e-10, 1e-5, 1e5, 1e10})
+        acc->test_values_error = std::max(acc->test_values_error, std::abs((double)scalar((T)v) - std::sqrt(v)));
+    if (!batch) return;
+
+    // Bit-uniform normals (log-uniform in value); an odd length reaches the tail
+    const size_t N = ((size_t)1 << 20) + 7;
+    std::vector<T> in(N + SPECIALS), out(N + SPECIALS);
+    std::mt19937_64 rng(0xba7c);
+    const uint64_t lo = bits_of(L::min()), span = bits_of(L::max()) - lo + 1;
+    for (size_t i = 0; i < N; i++) in[i] = from_bits<T>((typename FloatBits<T>::U)(lo + rng() % span));
+    std::copy(specials, specials + SPECIALS, in.begin() + N);
+    batch(in.data(), out.data(), in.size());
+    acc->batch_max_ulp = 0;
+    for (size_t i = 0; i < N; i++) {
+        typename FloatBits<T>::U a = bits_of(out[i]), b = bits_of((T)std::sqrt(in[i]));
+        acc->batch_max_ulp = std::max(acc->batch_max_ulp, std::isfinite(out[i]) ? (double)(a > b ? a - b : b - a) : INFINITY);
+    }
+    for (size_t i = 0; i < SPECIALS; i++) acc->special_mismatches += !same_result(out[N + i], (T)std::sqrt(specials[i]));
+    acc->specials += (int)SPECIALS;
+}
+
+static double plugin_scalar_loop(const float* data, size_t size, int iterations, const void* ctx) {
+    const sqrt_plugin_kernel* k = static_cast<const sqrt_plugin_kernel*>(ctx);
+    auto start = std::chrono::high_resolution_clock::now();
+    if (k->type == SQRT_PLUGIN_F32) {
+        volatile float result;
+        for (int i = 0; i < iterations; i++) result = k->scalar_f32(data[i % size]);
+        (void)result;
+    } else {
+        volatile double result;
+        for (int i = 0; i < iterations; i++) result = k->scalar_f64(data[i % size]);
+        (void)result;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+// Whole passes over the data, about `iterations` elements; ns per element
+static double plugin_batch_loop(const float* data, size_t size, int iterations, const void* ctx) {
+    const sqrt_plugin_kernel* k = static_cast<const sqrt_plugin_kernel*>(ctx);
+    const size_t passes = std::max<size_t>(1, (size_t)iterations / size);
+    std::vector<double> in64(data, data + size), out64(size);
+    std::vector<float> out32(size);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t p = 0; p < passes; p++) {
+        if (k->type == SQRT_PLUGIN_F32) k->batch_f32(data, out32.data(), size);
+        else k->batch_f64(in64.data(), out64.data(), size);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / ((double)passes * (double)size);
+}
+
+static const char* plugin_type_name(int type) { return type == SQRT_PLUGIN_F32 ? "f32" : "f64"; }
+
+// Interleaved rounds over one set of kernels, each compared with the first
+// kernel of its type
+static void plugin_speed_table(const std::vector<PluginKernel>& kernels, const std::vector<size_t>& rows,
+                               double (*loop)(const float*, size_t, int, const void*), const char* unit) {
+    std::vector<std::string> labels;
+    std::vector<SpeedKernel> speed;
+    for (size_t r : rows) labels.push_back(std::string(kernels[r].kernel->name) + " (" + plugin_type_name(kernels[r].kernel->type) + ")");
+    for (size_t i = 0; i < rows.size(); i++) speed.push_back(SpeedKernel{labels[i].c_str(), loop, kernels[rows[i]].kernel});
+    std::vector<float> data = speed_test_data();
+    std::vector<std::vector<double>> samples =
+        measure_interleaved(speed.data(), speed.size(), data.data(), data.size(), SPEED_ITERATIONS, SPEED_ROUNDS);
+
+    for (size_t i = 0; i < rows.size(); i++) {
+        size_t base = i;
+        for (size_t j = 0; j < i; j++)
+            if (kernels[rows[j]].kernel->type == kernels[rows[i]].kernel->type) {
+                base = j;
+                break;
+            }
+        SampleStats s = summarize(samples[i]);
+        std::cout << std::setw(30) << (labels[i] + ":") << std::fixed << std::setprecision(3) << std::setw(9)
+                  << s.median << " " << unit << " [" << s.lo << ", " << s.hi << "]";
+        if (s.rejected) std::cout << "  " << s.rejected << " outlier" << (s.rejected > 1 ? "s" : "");
+        if (base != i) std::cout << "  vs " << labels[base] << ": " << describe_comparison(compare_samples(samples[base], samples[i]));
+        std::cout << "\n";
+    }
+}
+
+int run_plugin(int argc, char** argv) {
+    if (argc < 1) {
+        std::cerr << "usage: sqrt plugin lib.so [lib.so ...]\n";
+        return 2;
+    }
+    std::vector<PluginKernel> kernels;
+    for (const sqrt_plugin_kernel& k : BUILTIN_KERNELS) kernels.push_back(PluginKernel{"built-in", &k});
+    const size_t builtins = kernels.size();
+    for (int i = 0; i < argc; i++)
+        if (!load_plugin(argv[i], &kernels)) return 1;
+
+    std::cout << "PLUGIN KERNELS (" << kernels.size() - builtins << " from " << argc << " plugin"
+              << (argc > 1 ? "s" : "") << ", " << builtins << " built-in)\n";
+    std::cout << std::string(96, '-') << "\n";
+    std::cout << "ACCURACY vs std::sqrt (f32: every positive normal; f64: sampled normals; batch: 2^20 random normals)\n";
+    std::cout << "  " << std::left << std::setw(30) << "kernel" << std::right << std::setw(10) << "max ulp"
+              << std::setw(11) << "max rel" << std::setw(11) << "batch ulp" << std::setw(14) << "specials"
+              << std::setw(13) << "test values" << "  source\n";
+    ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    for (const PluginKernel& pk : kernels) {
+        const sqrt_plugin_kernel& k = *pk.kernel;
+        PluginAccuracy acc;
+        if (k.type == SQRT_PLUGIN_F32) {
+            acc.scalar = range_proof_f32(FLT_MIN, FLT_MAX, k.scalar_f32, pool);
+            plugin_accuracy<float>(k.scalar_f32, k.batch_f32, &acc);
+        } else {
+            acc.scalar = range_proof_f64(DBL_MIN, DBL_MAX, k.scalar_f64, (uint64_t)1 << 22);
+            plugin_accuracy<double>(k.scalar_f64, k.batch_f64, &acc);
+        }
+        auto ulps = [](double u) {
+            std::ostringstream s;
+            if (u < 0) s << "-";
+            else if (std::isinf(u)) s << "inf";
+            else if (u >= 1e7) s << std::scientific << std::setprecision(2) << u;
+            else s << std::fixed << std::setprecision(0) << u;
+            return s.str();
+        };
+        std::cout << "  " << std::left << std::setw(30) << (std::string(k.name) + " (" + plugin_type_name(k.type) + ")")
+                  << std::right << std::setw(10) << ulps(acc.scalar.max_ulp) << std::setw(11) << std::scientific
+                  << std::setprecision(2) << acc.scalar.max_rel << std::setw(11) << ulps(acc.batch_max_ulp)
+                  << std::setw(14)
+                  << (acc.special_mismatches ? std::to_string(acc.special_mismatches) + "/" + std::to_string(acc.specials) + " differ"
+                                             : std::string("match"))
+                  << std::setw(13) << std::setprecision(2) << acc.test_values_error << "  " << pk.source << "\n";
+    }
+
+    BenchEnvironment env;
+    std::cout << "\n";
+    if (!preflight_or_refuse(true, &env, std::cout)) return 1;
+    std::vector<size_t> scalar_rows, batch_rows;
+    for (size_t i = 0; i < kernels.size(); i++) {
+        scalar_rows.push_back(i);
+        const sqrt_plugin_kernel& k = *kernels[i].kernel;
+        if (k.type == SQRT_PLUGIN_F32 ? (bool)k.batch_f32 : (bool)k.batch_f64) batch_rows.push_back(i);
+    }
+    std::cout << "SCALAR SPEED (" << SPEED_ROUNDS << " interleaved rounds x " << SPEED_ITERATIONS
+              << " iterations, median ns/call [95% CI])\n";
+    plugin_speed_table(kernels, scalar_rows, plugin_scalar_loop, "ns");
+    std::cout << "\nBATCH SPEED (" << SPEED_ROUNDS << " interleaved rounds, median ns/element [95% CI])\n";
+    plugin_speed_table(kernels, batch_rows, plugin_batch_loop, "ns");
+    if (preflight_mode() != PREFLIGHT_OFF) preflight_recheck(env, std::cout);
+    return 0;
+}
+
+// ==================== PRECISION-CONVERTING BATCHES ====================
+// Benchmark for the float -> double and double -> float sqrt_batch overloads
+// (see BATCH KERNELS): narrowing accuracy against a correctly rounded
+// reference, then fused against convert-then-root (or root-then-convert).
+
+// Correctly rounded float root by comparing x with squared float midpoints,
+// which are exact in double
+static float sqrt_to_float_reference(double x) {
+    float f = (float)std::sqrt(x);
+    if (!(f > 0) || std::isinf(f)) return f;
+    float hi = std::nextafter(f, INFINITY), lo = std::nextafter(f, 0.0f);
+    double mh = ((double)f + hi) / 2, ml = ((double)f + lo) / 2;
+    if (mh * mh < x || (mh * mh == x && !(bits_of(hi) & 1))) return hi;
+    if (ml * ml > x || (ml * ml == x && !(bits_of(lo) & 1))) return lo;
+    return f;
+}
+
+void convert_benchmark() {
+    // Roots near float midpoints (x = M^2 and its neighbours for 25-bit M),
+    // where rounding twice goes wrong, plus random positive doubles
+    std::mt19937_64 rng(23);
+    std::vector<double> x;
+    for (int i = 0; i < 1000000; i++) {
+        float f = from_bits<float>((uint32_t)(0x00800000u + rng() % 0x7f000000u));
+        double m = ((double)f + std::nextafter(f, INFINITY)) / 2, s = m * m;
+        x.push_back(std::nextafter(s, 0.0));
+        x.push_back(s);
+        x.push_back(std::nextafter(s, INFINITY));
+    }
+    for (int i = 0; i < 1000000; i++) x.push_back(from_bits<double>(rng() % bits_of(DBL_MAX)));
+    std::vector<float> ref(x.size()), out(x.size());
+    for (size_t i = 0; i < x.size(); i++) ref[i] = sqrt_to_float_reference(x[i]);
+
+    std::cout << "PRECISION-CONVERTING BATCHES\n";
+    std::cout << std::string(96, '-') << "\n";
+    std::cout << "  f64 -> f32 on " << x.size() << " inputs (3M next to float midpoints): max ulp vs correctly rounded\n";
+    auto max_ulp = [&](const std::vector<float>& r, size_t* wrong) {
+        double worst = 0;
+        *wrong = 0;
+        for (size_t i = 0; i < x.size(); i++) {
+            if (!(ref[i] > 0) || std::isinf(ref[i])) continue;
+            uint32_t a = bits_of(r[i]), b = bits_of(ref[i]);
+            worst = std::max(worst, std::isfinite(r[i]) ? (double)(a > b ? a - b : b - a) : INFINITY);
+            *wrong += a != b;
+        }
+        return worst;
+    };
+    size_t wrong;
+    std::vector<double> roots(x.size());
+    sqrt_batch(x.data(), roots.data(), x.size());
+    for (size_t i = 0; i < x.size(); i++) out[i] = (float)roots[i];
+    double worst = max_ulp(out, &wrong);
+    std::cout << "  " << std::left << std::setw(30) << "sqrt_batch(f64) then (float)" << std::right << std::setw(6)
+              << worst << " ulp, " << wrong << " wrong\n";
+    for (SqrtTier tier : {SQRT_EXACT, SQRT_OPTIMAL, SQRT_FAST}) {
+        sqrt_batch(x.data(), out.data(), x.size(), tier);
+        worst = max_ulp(out, &wrong);
+        std::cout << "  " << std::left << std::setw(30) << (std::string("sqrt_batch(f64->f32) ") + tier_name(tier))
+                  << std::right << std::setw(6) << worst << " ulp, " << wrong << " wrong\n";
+    }
+
+    // Float-range inputs, so narrowing takes the float kernels
+    const size_t BIG = (size_t)1 << 23, SMALL = 1024;
+    std::vector<float> f32(BIG);
+    std::vector<double> f64(BIG), tmp(BIG);
+    std::uniform_real_distribution<double> exponent(-30, 30);
+    for (size_t i = 0; i < BIG; i++) f64[i] = f32[i] = (float)std::pow(10.0, exponent(rng));
+    auto time = [](size_t n, auto fn) {
+        const int reps = (int)std::max<size_t>(1, ((size_t)1 << 22) / n);
+        std::vector<double> ns;
+        for (int k = 0; k < 9; k++) {
+            auto start = std::chrono::steady_clock::now();
+            for (int rep = 0; rep < reps; rep++) fn(n);
+            ns.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                         ((double)reps * (double)n));
+        }
+        return median_of(ns);
+    };
+    std::cout << "\n  median ns/element        " << std::setw(8) << SMALL << " elements (L1)  " << std::setw(9) << BIG
+              << " elements (DRAM)\n";
+    std::cout << "                           two-pass    fused         two-pass    fused\n";
+    auto row = [&](const std::string& name, auto two_pass, auto fused) {
+        double t[4] = {time(SMALL, two_pass), time(SMALL, fused), time(BIG, two_pass), time(BIG, fused)};
+        std::cout << "  " << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(11) << t[0] << std::setw(9) << t[1] << std::setprecision(2) << " (" << t[0] / t[1]
+                  << "x)" << std::setprecision(3) << std::setw(10) << t[2] << std::setw(9) << t[3]
+                  << std::setprecision(2) << " (" << t[2] / t[3] << "x)\n";
+    };
+    for (SqrtTier tier : {SQRT_EXACT, SQRT_OPTIMAL, SQRT_FAST}) {
+        row(std::string("f32->f64 ") + tier_name(tier),
+            [&](size_t n) {
+                for (size_t i = 0; i < n; i++) tmp[i] = f32[i];
+                sqrt_batch(tmp.data(), f64.data(), n, tier);
+            },
+            [&](size_t n) { sqrt_batch(f32.data(), f64.data(), n, tier); });
+    }
+    for (size_t i = 0; i < BIG; i++) f64[i] = f32[i];
+    for (SqrtTier tier : {SQRT_EXACT, SQRT_OPTIMAL, SQRT_FAST}) {
+        row(std::string("f64->f32 ") + tier_name(tier),
+            [&](size_t n) {
+                sqrt_batch(f64.data(), tmp.data(), n, tier);
+                for (size_t i = 0; i < n; i++) f32[i] = (float)tmp[i];
+            },
+            [&](size_t n) { sqrt_batch(f64.data(), f32.data(), n, tier); });
+    }
+}
+
+// ==================== BENCHMARKS ====================
+// sqrt bench <name>: focused benchmarks that are too slow or too specialized
+// for the default analysis run.
+
+struct NamedBenchmark {
+    const char* name;
+    const char* description;
+    void (*run)();
+};
+
+static const NamedBenchmark BENCHMARKS[] = {
+    {"incremental", "dirty-line recompute vs full pass over a persistent array", incremental_benchmark},
+    {"memo", "direct-mapped memo cache on repeat-heavy and unique inputs", memo_benchmark},
+    {"range", "range-specialized kernels: error bound proof and speed", range_benchmark},
+    {"multi", "sqrt2/sqrt4/sqrt8 vs sequential sqrt_optimal calls, latency mode", multi_benchmark},
+    {"interval", "sqrt_interval bounds vs MXCSR rounding-mode switching", interval_benchmark},
+    {"reduce", "fused sum/max reductions over roots vs materializing them", reduce_benchmark},
+    {"dual", "sqrt_rsqrt pairs vs sqrt followed by a division", dual_benchmark},
+    {"householder", "Halley/Householder rsqrt iterations vs Newton, latency mode", householder_benchmark},
+    {"correlation", "rolling correlation matrix vs a sqrt per entry", correlation_benchmark},
+    {"matsqrt", "blocked GEMM and Newton-Schulz matrix square roots", matrix_sqrt_benchmark},
+    {"ipc", "shared-memory service round trip vs in-process calls", ipc_benchmark},
+    {"realtime", "locked, prefaulted, pinned profile: latency and rusage self-check", realtime_benchmark},
+    {"convert", "fused f32->f64 / f64->f32 roots vs separate conversion passes", convert_benchmark},
+#if defined(SQRT_COROUTINES)
+    {"async", "co_await async_sqrt: reactor stalls, cancellation, per-op cost", async_benchmark},
+#endif
+};
+
+int run_bench(int argc, char** argv) {
+    bool ran = false;
+    // Benchmarks use the pool, so the preflight checks but doesn't pin
+    BenchEnvironment env;
+    if (argc > 0 && !preflight_or_refuse(false, &env, std::cout)) return 1;
+    for (const NamedBenchmark& b : BENCHMARKS) {
+        if (argc == 0 || !std::strcmp(argv[0], b.name) || !std::strcmp(argv[0], "all")) {
+            if (argc == 0) {
+                std::cout << "  " << std::left << std::setw(14) << b.name << std::right << b.description << "\n";
+                continue;
+            }
+            TraceScope span(b.name);
+            b.run();
+            ran = true;
+        }
+    }
+    if (argc == 0) return 0;
+    if (!ran) {
+        std::cerr << "unknown benchmark: " << argv[0] << " (run 'sqrt bench' for the list)\n";
+        return 2;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+#if defined(SQRT_INSTRUMENT)
+    std::atexit([] { sqrt_counters_report(std::cerr); });
+#endif
+    if (std::getenv("SQRT_TRACE")) {
+        sqrt_trace_start();
+        sqrt_trace_thread_name("main");
+        std::atexit([] {
+            const char* path = std::getenv("SQRT_TRACE");
+            if (!sqrt_trace_dump(path)) std::perror(path);
+        });
+    }
+
+    // Tools: sqrt <command> [options]
+    if (argc > 1 && std::strcmp(argv[1], "filter") == 0) return run_filter(argc - 2, argv + 2);
+    if (argc > 1 && std::strcmp(argv[1], "mmap") == 0) return run_mmap(argc - 2, argv + 2);
+    if (argc > 1 && std::strcmp(argv[1], "uring") == 0) return run_uring(argc - 2, argv + 2);
+    if (argc > 1 && std::strcmp(argv[1], "sqb") == 0) return run_sqb(argc - 2, argv + 2);
+    if (argc > 1 && std::strcmp(argv[1], "bench") == 0) return run_bench(argc - 2, argv + 2);
+    if (argc > 1 && std::strcmp(argv[1], "pareto") == 0) return run_pareto(argc - 2, argv + 2);
+    if (argc > 1 && std::strcmp(argv[1], "serve") == 0) return run_serve(argc - 2, argv + 2);
+    if (argc > 1 && std::strcmp(argv[1], "plugin") == 0) return run_plugin(argc - 2, argv + 2);
+    if (argc > 1) {
+        std::cerr << "usage: sqrt               run the accuracy/speed analysis\n"
+                  << "       sqrt filter ...    text numbers in, square roots out\n"
+                  << "       sqrt mmap ...      raw float32/float64 file transform\n"
+                  << "       sqrt uring ...     out-of-core transform over io_uring\n"
+                  << "       sqrt sqb ...       block container: pack, root, unpack, info\n"
+                  << "       sqrt bench [name]  focused benchmarks (no name: list them)\n"
+                  << "       sqrt pareto ...    accuracy/speed frontier of the kernel design space\n"
+                  << "       sqrt serve ...     shared-memory sqrt daemon for local clients\n"
+                  << "       sqrt plugin lib.so ... accuracy/speed suite on out-of-tree kernels\n";
+        return 2;
+    }
+
     std::cout << "\nSQUARE ROOT: Production-Quality Analysis\n\n";
     
     // Quick validation
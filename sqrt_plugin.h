@@ -0,0 +1,48 @@
+// Kernel table for out-of-tree square root implementations.
+//
+// A plugin is a shared object exporting sqrt_plugin_kernels(). `sqrt plugin
+// lib.so ...` loads it with dlopen and runs each kernel through the same
+// accuracy sweep and interleaved speed rounds as the built-in kernels
+// (std::sqrt, sqrt_sse_fast, sqrt_optimal and their sqrt_batch tiers).
+//
+//   g++ -O3 -march=native -shared -fPIC my_kernels.cpp -o libmy_kernels.so
+//   ./sqrt plugin ./libmy_kernels.so
+//
+// See sqrt_plugin_example.cpp. Plain C, so plugins can be C or C++.
+
+#ifndef SQRT_PLUGIN_H
+#define SQRT_PLUGIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SQRT_PLUGIN_ABI 1
+#define SQRT_PLUGIN_ENTRY "sqrt_plugin_kernels"
+
+enum sqrt_plugin_type {
+    SQRT_PLUGIN_F32 = 1,  // scalar_f32 and (optionally) batch_f32 are set
+    SQRT_PLUGIN_F64 = 2   // scalar_f64 and (optionally) batch_f64 are set
+};
+
+typedef struct sqrt_plugin_kernel {
+    const char* name; // required; unnamed kernels are skipped
+    int type;         // sqrt_plugin_type
+    const char* isa;  // comma-separated requirements: scalar, sse, sse2, sse4.1, avx, avx2, fma, avx512f
+    float (*scalar_f32)(float);
+    double (*scalar_f64)(double);
+    void (*batch_f32)(const float* in, float* out, size_t n);
+    void (*batch_f64)(const double* in, double* out, size_t n);
+} sqrt_plugin_kernel;
+
+typedef struct sqrt_plugin_table {
+    uint32_t abi;  // SQRT_PLUGIN_ABI
+    uint32_t count;
+    const sqrt_plugin_kernel* kernels;
+} sqrt_plugin_table;
+
+#ifdef __cplusplus
+extern "C"
+#endif
+const sqrt_plugin_table* sqrt_plugin_kernels(void);
+
+#endif
@@ -0,0 +1,74 @@
+// Example sqrt plugin: two experimental kernels in the sqrt_plugin.h format.
+//
+//   g++ -O3 -march=native -shared -fPIC sqrt_plugin_example.cpp -o libsqrt_example.so
+//   ./sqrt plugin ./libsqrt_example.so
+
+#include "sqrt_plugin.h"
+
+#include <immintrin.h>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// rsqrtss seed, one Halley step on 1/sqrt(x): y * (1 + e/2 + 3e^2/8) with
+// e = 1 - x*y^2, so the 12-bit seed lands near float precision in one step
+static float rsqrt_halley(float x) {
+    if (!(x >= FLT_MIN && x <= FLT_MAX)) return std::sqrt(x);
+    float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+    float e = 1.0f - x * y * y;
+    y = y + y * e * (0.5f + 0.375f * e);
+    return x * y;
+}
+
+static void rsqrt_halley_batch(const float* in, float* out, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+    const __m256 lo = _mm256_set1_ps(FLT_MIN), hi = _mm256_set1_ps(FLT_MAX);
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(in + i);
+        __m256 y = _mm256_rsqrt_ps(x);
+        __m256 e = _mm256_fnmadd_ps(_mm256_mul_ps(x, y), y, _mm256_set1_ps(1.0f));
+        __m256 p = _mm256_fmadd_ps(e, _mm256_set1_ps(0.375f), _mm256_set1_ps(0.5f));
+        y = _mm256_fmadd_ps(_mm256_mul_ps(y, e), p, y);
+        __m256 r = _mm256_mul_ps(x, y);
+        __m256 bad = _mm256_or_ps(_mm256_cmp_ps(x, lo, _CMP_NGE_UQ), _mm256_cmp_ps(x, hi, _CMP_NLE_UQ));
+        if (!_mm256_testz_ps(bad, bad)) r = _mm256_blendv_ps(r, _mm256_sqrt_ps(x), bad);
+        _mm256_storeu_ps(out + i, r);
+    }
+#endif
+    for (; i < n; i++) out[i] = rsqrt_halley(in[i]);
+}
+
+// Bit-pattern seed and three Newton steps on 1/sqrt(x), no hardware rsqrt
+static double magic_newton3(double x) {
+    if (!(x >= DBL_MIN && x <= DBL_MAX)) return std::sqrt(x);
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    bits = 0x5fe6eb50c7b537a9ULL - (bits >> 1);
+    double y;
+    std::memcpy(&y, &bits, sizeof(y));
+    const double h = 0.5 * x;
+    for (int k = 0; k < 3; k++) y = y * (1.5 - h * y * y);
+    return x * y;
+}
+
+static void magic_newton3_batch(const double* in, double* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = magic_newton3(in[i]);
+}
+
+static const sqrt_plugin_kernel KERNELS[] = {
+    {"example rsqrt+Halley", SQRT_PLUGIN_F32,
+#if defined(__AVX2__) && defined(__FMA__)
+     "sse,avx2,fma",
+#else
+     "sse",
+#endif
+     rsqrt_halley, nullptr, rsqrt_halley_batch, nullptr},
+    {"example magic+3 Newton", SQRT_PLUGIN_F64, "scalar", nullptr, magic_newton3, nullptr, magic_newton3_batch},
+};
+
+extern "C" const sqrt_plugin_table* sqrt_plugin_kernels(void) {
+    static const sqrt_plugin_table table = {SQRT_PLUGIN_ABI, sizeof(KERNELS) / sizeof(KERNELS[0]), KERNELS};
+    return &table;
+}
@@ -0,0 +1,212 @@
+// Regression tests for edge cases that once slipped past the analysis run.
+// Builds against sqrt.cpp directly:
+//
+//   g++ -std=c++20 -O2 -march=native -pthread tests/regress.cpp -o regress && ./regress
+
+#define main sqrt_main
+#include "../sqrt.cpp"
+#undef main
+
+static int failures = 0;
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond "\n"; \
+            failures++;                                                              \
+        }                                                                            \
+    } while (0)
+
+// Values just above FLT_MAX share float's top exponent but narrow to inf, so
+// a fast-tier sqb block holding one must not take the unchecked clean path.
+static void test_sqb_fast_above_flt_max() {
+    char dir[] = "/tmp/sqrt-regress-XXXXXX";
+    if (!mkdtemp(dir)) { std::perror("mkdtemp"); failures++; return; }
+    const std::string raw = std::string(dir) + "/in.f64", packed = std::string(dir) + "/in.sqb",
+                      rooted = std::string(dir) + "/out.sqb";
+    const double x = 3.4028236e38;
+    int fd = open(raw.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0 && write_all(fd, (const char*)&x, sizeof(x)) && close(fd) == 0);
+    CHECK(sqb_pack(raw.c_str(), packed.c_str(), SQB_F64, 64) == 0);
+    CHECK(sqb_root(packed.c_str(), rooted.c_str(), 1, SQRT_FAST) == 0);
+    SqbFile out;
+    if (out.map(rooted.c_str(), false) && out.valid()) {
+        const double root = *(const double*)out.payload(0);
+        CHECK(std::fabs(root - 1.8446743886117138e19) <= 1e-6 * 1.8446743886117138e19);
+    } else {
+        CHECK(!"output is a valid .sqb file");
+    }
+    unlink(raw.c_str());
+    unlink(packed.c_str());
+    unlink(rooted.c_str());
+    rmdir(dir);
+}
+
+// The whole run of separators after a number decides its layout: trailing
+// spaces or a trailing comma before a line break still end the line
+static void test_filter_separator_runs() {
+    char dir[] = "/tmp/sqrt-regress-XXXXXX";
+    if (!mkdtemp(dir)) { std::perror("mkdtemp"); failures++; return; }
+    const std::string in = std::string(dir) + "/in.txt", out = std::string(dir) + "/out.txt";
+    const struct { const char* input; const char* expected; } cases[] = {
+        {"1 \n4\n9", "1\n2\n3\n"},
+        {"1,\n4", "1\n2\n"},
+        {"1 ,\t4 \r\n9, 16 ", "1,2\n3,4\n"},
+        {"1,4\n9,16\n", "1,2\n3,4\n"},
+    };
+    for (const auto& c : cases) {
+        for (const char* threads : {"1", "3"}) {
+            int fd = open(in.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            CHECK(fd >= 0 && write_all(fd, c.input, std::strlen(c.input)) && close(fd) == 0);
+            const char* argv[] = {"-j", threads, "-o", out.c_str(), in.c_str()};
+            CHECK(run_filter(5, (char**)argv) == 0);
+            std::ifstream f(out);
+            std::string got((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+            CHECK(got == c.expected);
+        }
+    }
+    unlink(in.c_str());
+    unlink(out.c_str());
+    rmdir(dir);
+}
+
+// A block header whose count exceeds block_elems must be reported as corrupt,
+// not used as a payload length.
+static void test_sqb_bad_block_count() {
+    char dir[] = "/tmp/sqrt-regress-XXXXXX";
+    if (!mkdtemp(dir)) { std::perror("mkdtemp"); failures++; return; }
+    const std::string raw = std::string(dir) + "/in.f32", packed = std::string(dir) + "/in.sqb",
+                      rooted = std::string(dir) + "/out.sqb";
+    std::vector<float> values(100, 2.0f);
+    int fd = open(raw.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0 && write_all(fd, (const char*)values.data(), values.size() * sizeof(float)) && close(fd) == 0);
+    CHECK(sqb_pack(raw.c_str(), packed.c_str(), SQB_F32, 64) == 0);
+    {
+        SqbFile f;
+        CHECK(f.map(packed.c_str(), true) && f.valid());
+        if (f.base) f.block(1)->count = 1u << 30;
+    }
+    CHECK(sqb_root(packed.c_str(), rooted.c_str(), 1, SQRT_EXACT) == 1);
+    unlink(raw.c_str());
+    unlink(packed.c_str());
+    unlink(rooted.c_str());
+    rmdir(dir);
+}
+
+// Every batch API works in place; the memo cache's must too, even when the
+// lanes miss and have to be computed from the input it is overwriting.
+static void test_memo_batch_in_place() {
+    SqrtMemo<sqrt_optimal>* memo = new SqrtMemo<sqrt_optimal>();
+    double a[8], want[8];
+    for (int k = 0; k < 8; k++) {
+        a[k] = (double)((k + 2) * (k + 2));
+        want[k] = sqrt_optimal(a[k]);
+    }
+    memo->batch(a, a, 8);
+    for (int k = 0; k < 8; k++) CHECK(a[k] == want[k]);
+    delete memo;
+}
+
+// min/argmin over all-+inf inputs must agree between the AVX2 body (n >= 16)
+// and the scalar tail: the root is +inf at index 0, not "no valid input".
+static void test_min_sqrt_all_inf() {
+    for (size_t n : {5, 16, 32, 37}) {
+        std::vector<double> v(n, INFINITY);
+        CHECK(min_sqrt(v.data(), n) == INFINITY);
+        CHECK(argmin_sqrt(v.data(), n) == 0);
+        CHECK(max_sqrt(v.data(), n) == INFINITY);
+        CHECK(argmax_sqrt(v.data(), n) == 0);
+        v[n - 1] = 4.0;
+        CHECK(min_sqrt(v.data(), n) == 2.0);
+        CHECK(argmin_sqrt(v.data(), n) == n - 1);
+    }
+}
+
+// Forks a one-client daemon and connects to it; 0 if either step failed
+static pid_t start_service(SqrtServiceClient* client) {
+    ServiceConfig cfg;
+    cfg.name = "/sqrt-regress-" + std::to_string(getpid());
+    cfg.clients = 1;
+    cfg.arena_bytes = (size_t)1 << 20;
+    std::cout.flush();
+    pid_t child = fork();
+    if (child < 0) { std::perror("fork"); failures++; return 0; }
+    if (child == 0) _exit(service_run(cfg));
+    for (int attempt = 0; attempt < 2000 && !client->connect(cfg.name.c_str()); attempt++) usleep(1000);
+    CHECK(client->connected());
+    return child;
+}
+
+static void stop_service(SqrtServiceClient* client, pid_t child) {
+    client->disconnect();
+    if (child <= 0) return;
+    kill(child, SIGTERM);
+    waitpid(child, nullptr, 0);
+}
+
+// A rejected request stays rejected after a later ticket has been waited on
+static void test_service_wait_per_ticket() {
+    SqrtServiceClient client;
+    pid_t child = start_service(&client);
+    if (client.connected()) {
+        double* in = (double*)client.arena();
+        const size_t half = client.arena_bytes() / (2 * sizeof(double));
+        for (size_t i = 0; i < 4; i++) in[i] = (double)((i + 1) * (i + 1));
+        uint64_t bad = client.submit(in, in + half, 2 * half);  // runs past the arena
+        uint64_t good = client.submit(in, in + half, 4);
+        CHECK(bad != 0 && good != 0);
+        CHECK(client.wait(good));
+        CHECK(!client.wait(bad));
+        CHECK(client.wait(good));
+        CHECK(in[half + 3] == 4.0);
+    }
+    stop_service(&client, child);
+}
+
+struct SqrtServiceClientTest {
+    static void set_sequence(SqrtServiceClient* c, uint32_t s) { c->sequence = c->completed = s; }
+};
+
+// Request sequence numbers wrap after 2^32 requests on one connection; the
+// client must keep ordering tickets and draining responses across the wrap
+static void test_service_sequence_wrap() {
+    SqrtServiceClient client;
+    pid_t child = start_service(&client);
+    if (client.connected()) {
+        SqrtServiceClientTest::set_sequence(&client, 0xfffffff0u);
+        double* in = (double*)client.arena();
+        const size_t half = client.arena_bytes() / (2 * sizeof(double));
+        in[0] = 81.0;
+        int served = 0;
+        for (int k = 0; k < 3 * (int)SERVICE_RING; k++) served += client.sqrt(in, in + half, 1);
+        CHECK(served == 3 * (int)SERVICE_RING);
+        CHECK(in[half] == 9.0);
+
+        // Out-of-order waits across the wrap, with 0 skipped as a sequence number
+        SqrtServiceClientTest::set_sequence(&client, 0xfffffffdu);
+        uint64_t before = client.submit(in, in + half, 1);
+        uint64_t bad = client.submit(in, in + half, 2 * half);
+        uint64_t after = client.submit(in, in + half, 1);
+        CHECK((uint32_t)bad == 0xffffffffu && (uint32_t)after == 1);
+        CHECK(client.wait(after));
+        CHECK(client.wait(before));
+        CHECK(!client.wait(bad));
+    }
+    stop_service(&client, child);
+}
+
+int main() {
+    test_filter_separator_runs();
+    test_sqb_fast_above_flt_max();
+    test_sqb_bad_block_count();
+    test_memo_batch_in_place();
+    test_min_sqrt_all_inf();
+    test_service_wait_per_ticket();
+    test_service_sequence_wrap();
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "all regression tests passed\n";
+    return 0;
+}